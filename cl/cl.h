@@ -12,15 +12,39 @@
  *      @(#)cl.h        10.19 (Berkeley) 9/24/96
  */
 
+extern  GS *__global_list;
+
 extern  volatile sig_atomic_t cl_sigint;
 extern  volatile sig_atomic_t cl_sigterm;
 extern  volatile sig_atomic_t cl_sigwinch;
 
+/* Terminal output statistics, see cl_out.c. */
+typedef struct _cl_ostat {
+        u_long   o_updates;     /* Screen updates. */
+        u_long   o_bytes;       /* Bytes written, current update. */
+        u_long   o_writes;      /* Writes, current update. */
+        u_long   o_lbytes;      /* Bytes written, last update. */
+        u_long   o_lwrites;     /* Writes, last update. */
+        u_long   o_mbytes;      /* Bytes written, largest update. */
+        u_long   o_tbytes;      /* Bytes written, total. */
+        u_long   o_twrites;     /* Writes, total. */
+} CL_OSTAT;
+
 typedef struct _cl_private {
         CHAR_T   ibuf[512];     /* Input keys. */
+        size_t   ioff;          /* Unreturned input keys offset. */
+        size_t   ilen;          /* Unreturned input keys length. */
 
         int      eof_count;     /* EOF count. */
 
+        struct pollfd *pfd;     /* Event loop poll(2) array. */
+        size_t   pfd_len;       /* Event loop poll(2) array length. */
+
+        char    *obuf;          /* Pending terminal output. */
+        size_t   obuf_len;      /* Pending terminal output length. */
+        size_t   obuf_size;     /* Terminal output buffer size. */
+        CL_OSTAT ostat;         /* Terminal output statistics. */
+
         struct termios orig;    /* Original terminal values. */
         struct termios ex_enter;/* Terminal values to enter ex. */
         struct termios vi_enter;/* Terminal values to enter vi. */
@@ -30,6 +54,8 @@ typedef struct _cl_private {
         char    *cuu1;          /* Cursor up terminal string. */
         char    *rmso, *smso;   /* Inverse video terminal strings. */
         char    *smcup, *rmcup; /* Terminal start/stop strings. */
+        char    *be, *bd;       /* Bracketed paste enable/disable strings. */
+        char    *ps, *pe;       /* Bracketed paste start/end markers. */
 
 #define INDX_HUP        0
 #define INDX_INT        1
@@ -50,6 +76,7 @@ typedef struct _cl_private {
 #define CL_SCR_EX_INIT  0x0008  /* Ex screen initialized. */
 #define CL_SCR_VI_INIT  0x0010  /* Vi screen initialized. */
 #define CL_STDIN_TTY    0x0020  /* Talking to a terminal. */
+#define CL_BPASTE       0x0040  /* Bracketed paste mode enabled. */
         u_int32_t flags;
 } CL_PRIVATE;
 
@@ -65,4 +92,8 @@ typedef enum { INP_OK=0, INP_EOF, INP_ERR, INP_INTR, INP_TIMEOUT } input_t;
 /* X11 xterm escape sequence to rename the icon/window. */
 #define XTERM_RENAME    "\033]0;%s\007"
 
+/* Default bracketed paste markers, if the terminal doesn't specify them. */
+#define BPASTE_START    "\033[200~"
+#define BPASTE_END      "\033[201~"
+
 #include "cl_extern.h"
@@ -51,10 +51,16 @@ int cl_event(SCR *, EVENT *, u_int32_t, int);
 int cl_screen(SCR *, u_int32_t);
 int cl_quit(GS *);
 int cl_getcap(SCR *, char *, char **);
+void cl_bpaste(CL_PRIVATE *, int);
 int cl_term_init(SCR *);
 int cl_term_end(GS *);
 int cl_fmap(SCR *, seq_t, CHAR_T *, size_t, CHAR_T *, size_t);
 int cl_optchange(SCR *, int, char *, u_long *);
 int cl_omesg(SCR *, CL_PRIVATE *, int);
 int cl_ssize(SCR *, int, size_t *, size_t *, int *);
+void cl_oadd(CL_PRIVATE *, const char *, size_t);
+void cl_oprintf(CL_PRIVATE *, const char *, ...);
+void cl_oflush(CL_PRIVATE *);
+void cl_oupdate(SCR *);
+int cl_ostat(SCR *);
 int cl_putchar(int);
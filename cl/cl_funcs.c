@@ -44,6 +44,15 @@ cl_addstr(SCR *sp, const char *str, size_t len)
         size_t oldy, oldx;
         int iv;
 
+        /*
+         * If ex is in control of the screen, the output goes straight to
+         * the terminal, not through curses.
+         */
+        if (F_ISSET(sp, SC_SCR_EX)) {
+                cl_oadd(CLP(sp), str, len);
+                return (0);
+        }
+
         /*
          * If ex isn't in control, it's the last line of the screen and
          * it's a split screen, use inverse video.
@@ -123,8 +132,14 @@ cl_attr(SCR *sp, scr_attr_t attribute, int on)
                                 (void)cl_getcap(sp, "rmcup", &clp->rmcup);
                         if (clp->rmcup != NULL)
                                 (void)tputs(clp->rmcup, 1, cl_putchar);
-                        (void)fflush(stdout);
                 }
+
+        /*
+         * The alternate screen is switched around running other programs,
+         * the sequences have to be on the terminal before they start.
+         */
+        cl_oflush(clp);
+        (void)fflush(stdout);
         break;
         case SA_INVERSE:
                 if (F_ISSET(sp, SC_EX | SC_SCR_EXWROTE)) {
@@ -134,7 +149,6 @@ cl_attr(SCR *sp, scr_attr_t attribute, int on)
                                 (void)tputs(clp->smso, 1, cl_putchar);
                         else
                                 (void)tputs(clp->rmso, 1, cl_putchar);
-                        (void)fflush(stdout);
                 } else {
                         if (on)
                                 (void)standout();
@@ -143,10 +157,9 @@ cl_attr(SCR *sp, scr_attr_t attribute, int on)
                 }
                 break;
         default:
-                (void)fflush(stdout);
+                cl_oflush(clp);
                 abort();
         }
-        (void)fflush(stdout);
         return (0);
 }
 
@@ -200,8 +213,11 @@ cl_baud(SCR *sp, u_long *ratep)
 int
 cl_bell(SCR *sp)
 {
+        CL_PRIVATE *clp;
+
+        clp = CLP(sp);
         if (F_ISSET(sp, SC_EX | SC_SCR_EXWROTE))
-                (void)write(STDOUT_FILENO, "\07", 1);           /* \a */
+                cl_oadd(clp, "\07", 1);                         /* \a */
         else {
                 /*
                  * If the screen has not been setup we cannot call
@@ -212,12 +228,13 @@ cl_bell(SCR *sp)
                          * Vi has an edit option which determines if the
                          * terminal should be beeped or the screen flashed.
                          */
+                        cl_oflush(clp);
                         if (O_ISSET(sp, O_FLASH))
                                 (void)flash();
                         else
                                 (void)beep();
                 } else if (!O_ISSET(sp, O_FLASH))
-                        (void)write(STDOUT_FILENO, "\07", 1);
+                        cl_oadd(clp, "\07", 1);
         }
         return (0);
 }
@@ -325,7 +342,7 @@ cl_ex_adjust(SCR *sp, exadj_t action)
         case EX_TERM_CE:
                 /* Clear the line. */
                 if (clp->el != NULL) {
-                        (void)putchar('\r');
+                        cl_oadd(clp, "\r", 1);
                         (void)tputs(clp->el, 1, cl_putchar);
                 } else {
                         /*
@@ -340,11 +357,10 @@ cl_ex_adjust(SCR *sp, exadj_t action)
                          * it's almost certainly not worth the effort.
                          */
                         for (cnt = 0; cnt < MAX_CHARACTER_COLUMNS; ++cnt)
-                                (void)putchar('\b');
+                                cl_oadd(clp, "\b", 1);
                         for (cnt = 0; cnt < MAX_CHARACTER_COLUMNS; ++cnt)
-                                (void)putchar(' ');
-                        (void)putchar('\r');
-                        (void)fflush(stdout);
+                                cl_oadd(clp, " ", 1);
+                        cl_oadd(clp, "\r", 1);
                 }
                 break;
         default:
@@ -367,23 +383,27 @@ cl_imctrl(SCR *sp, imctrl_t action)
 #define TT_IM_RESTORE   "\033[<r"       /* TTIMERS */
 #define TT_IM_SAVE      "\033[<s"       /* TTIMESV */
 
+        CL_PRIVATE *clp;
+
         if (!O_ISSET(sp, O_IMCTRL) && action != IMCTRL_INIT)
                 return;
 
+        clp = CLP(sp);
         switch (action) {
         case IMCTRL_INIT:
-                (void)printf(TT_IM_OFF TT_IM_SAVE);
+                cl_oadd(clp, TT_IM_OFF TT_IM_SAVE,
+                    sizeof(TT_IM_OFF TT_IM_SAVE) - 1);
                 break;
         case IMCTRL_OFF:
-                (void)printf(TT_IM_SAVE TT_IM_OFF);
+                cl_oadd(clp, TT_IM_SAVE TT_IM_OFF,
+                    sizeof(TT_IM_SAVE TT_IM_OFF) - 1);
                 break;
         case IMCTRL_ON:
-                (void)printf(TT_IM_RESTORE);
+                cl_oadd(clp, TT_IM_RESTORE, sizeof(TT_IM_RESTORE) - 1);
                 break;
         default:
                 abort();
         }
-        (void)fflush(stdout);
 }
 
 /*
@@ -468,9 +488,9 @@ int
 cl_refresh(SCR *sp, int repaint)
 {
         CL_PRIVATE *clp;
+        int rval;
 
         clp = CLP(sp);
-        (void)clp;
 
         /*
          * If we received a killer signal, we're done, there's no point
@@ -479,6 +499,15 @@ cl_refresh(SCR *sp, int repaint)
         if (cl_sigterm)
                 return (0);
 
+        /* Ex output isn't managed by curses, just write it. */
+        if (F_ISSET(sp, SC_SCR_EX)) {
+                cl_oupdate(sp);
+                return (0);
+        }
+
+        /* Our output has to precede anything curses writes. */
+        cl_oflush(clp);
+
         /*
          * If repaint is set, the editor is telling us that we don't know
          * what's on the screen, so we have to repaint from scratch.
@@ -489,7 +518,10 @@ cl_refresh(SCR *sp, int repaint)
          */
         if (repaint)
                 clearok(curscr, 1);
-        return (refresh() == ERR);
+        rval = refresh() == ERR;
+
+        cl_oupdate(sp);
+        return (rval);
 }
 
 /*
@@ -518,14 +550,12 @@ cl_rename(SCR *sp, char *name, int on)
                 if (F_ISSET(clp, CL_RENAME_OK) &&
                     !strncmp(ttype, "xterm", sizeof("xterm") - 1)) {
                         F_SET(clp, CL_RENAME);
-                        (void)printf(XTERM_RENAME, name);
-                        (void)fflush(stdout);
+                        cl_oprintf(clp, XTERM_RENAME, name);
                 }
         } else
                 if (F_ISSET(clp, CL_RENAME)) {
                         F_CLR(clp, CL_RENAME);
-                        (void)printf(XTERM_RENAME, ttype);
-                        (void)fflush(stdout);
+                        cl_oprintf(clp, XTERM_RENAME, ttype);
                 }
         return (0);
 }
@@ -567,6 +597,7 @@ cl_suspend(SCR *sp, int *allowedp)
                 }
 
                 /* Stop the process group. */
+                cl_oflush(clp);
                 (void)kill(0, SIGTSTP);
 
                 /* Time passes ... */
@@ -585,6 +616,7 @@ cl_suspend(SCR *sp, int *allowedp)
          * shouldn't hurt.
          */
         getyx(stdscr, oldy, oldx);
+        cl_oflush(clp);
         (void)move(LINES - 1, 0);
         (void)refresh();
 
@@ -597,8 +629,10 @@ cl_suspend(SCR *sp, int *allowedp)
         /* Restore the cursor keys to normal mode. */
         (void)keypad(stdscr, FALSE);
 
-        /* Restore the window name. */
+        /* Restore the window name, turn off bracketed paste mode. */
         (void)cl_rename(sp, NULL, 0);
+        cl_bpaste(clp, 0);
+        cl_oflush(clp);
 
         (void)endwin();
 
@@ -632,6 +666,10 @@ cl_suspend(SCR *sp, int *allowedp)
         /* Put the cursor keys into application mode. */
         (void)keypad(stdscr, TRUE);
 
+        /* Turn bracketed paste mode back on. */
+        if (O_ISSET(sp, O_BRACKETPASTE))
+                cl_bpaste(clp, 1);
+
         /* Refresh and repaint the screen. */
         (void)move(oldy, oldx);
         (void)cl_refresh(sp, 1);
@@ -658,9 +696,9 @@ cl_usage()
         case MODE_EX:
                 (void)fprintf(stderr, "Usage: "
 #ifdef DEBUG
-                    "ex [ -FRrSsv ] [ -c cmd ] [ -t tag ] [ -w size ] [ -T tracefile ] [ file ... ]\n");
+                    "ex [ -FRrSsv ] [ -b script [ -j jobs ] ] [ -c cmd ] [ -t tag ] [ -w size ] [ -T tracefile ] [ file ... ]\n");
 #else
-                    "ex [ -FRrSsv ] [ -c cmd ] [ -t tag ] [ -w size ] [ file ... ]\n");
+                    "ex [ -FRrSsv ] [ -b script [ -j jobs ] ] [ -c cmd ] [ -t tag ] [ -w size ] [ file ... ]\n");
 #endif /* ifdef DEBUG */
                 break;
         case MODE_VI:
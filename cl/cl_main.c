@@ -45,6 +45,7 @@ volatile sig_atomic_t cl_sigint;
 volatile sig_atomic_t cl_sigterm;
 volatile sig_atomic_t cl_sigwinch;
 
+static int         cl_batch(char *[]);
 static void        cl_func_std(GS *);
 static CL_PRIVATE *cl_init(GS *);
 static GS         *gs_init(void);
@@ -76,11 +77,14 @@ main(int argc, char *argv[])
          *
          * We have to know what terminal it is from the start, since we may
          * have to use termcap/terminfo to find out how big the screen is.
+         * Batch sessions never draw a screen, and skip all of it.
          */
         if ((ttype = getenv("TERM")) == NULL)
                 ttype = "unknown";
-        term_init(ttype);
-        ttype = getenv("TERM");
+        if (!cl_batch(argv)) {
+                term_init(ttype);
+                ttype = getenv("TERM");
+        }
 
         /* Add the terminal type to the global structure. */
         if ((OG_D_STR(gp, GO_TERM) =
@@ -88,7 +92,10 @@ main(int argc, char *argv[])
                 err(1, NULL);
 
         /* Figure out how big the screen is. */
-        if (cl_ssize(NULL, 0, &rows, &cols, NULL))
+        if (cl_batch(argv)) {
+                rows = 24;
+                cols = 80;
+        } else if (cl_ssize(NULL, 0, &rows, &cols, NULL))
                 exit (1);
 
         /* Add the rows and columns to the global structure. */
@@ -122,10 +129,9 @@ main(int argc, char *argv[])
          * XXX
          * Reset the X11 xterm icon/window name.
          */
-        if (F_ISSET(clp, CL_RENAME)) {
-                (void)printf(XTERM_RENAME, ttype);
-                (void)fflush(stdout);
-        }
+        if (F_ISSET(clp, CL_RENAME))
+                cl_oprintf(clp, XTERM_RENAME, ttype);
+        cl_oflush(clp);
 
         /* If a killer signal arrived, pretend we just got it. */
         if (cl_sigterm) {
@@ -136,6 +142,8 @@ main(int argc, char *argv[])
 
         /* Free the global and CL private areas. */
 #if defined(DEBUG) || defined(PURIFY)
+        free(clp->obuf);
+        free(clp->pfd);
         free(clp);
         free(gp);
 #endif /* if defined(DEBUG) || defined(PURIFY) */
@@ -159,6 +167,33 @@ gs_init(void)
         return (gp);
 }
 
+/*
+ * cl_batch --
+ *      Check for the -b option before editor() parses the arguments, so
+ *      the terminal isn't initialized for a batch session.
+ */
+static int
+cl_batch(char *argv[])
+{
+        char *p;
+
+        while ((p = *++argv) != NULL && p[0] == '-' && p[1] != '\0') {
+                if (!strcmp(p, "--"))
+                        break;
+                for (++p; *p != '\0'; ++p) {
+                        if (*p == 'b')
+                                return (1);
+                        /* Skip the options that take an argument. */
+                        if (strchr("cDjTtw", *p) != NULL) {
+                                if (p[1] == '\0' && *++argv == NULL)
+                                        return (0);
+                                break;
+                        }
+                }
+        }
+        return (0);
+}
+
 /*
  * cl_init --
  *      Create and partially initialize the CL structure.
@@ -351,6 +386,7 @@ cl_func_std(GS *gp)
         gp->scr_move      = cl_move;
         gp->scr_msg       = NULL;
         gp->scr_optchange = cl_optchange;
+        gp->scr_ostat     = cl_ostat;
         gp->scr_refresh   = cl_refresh;
         gp->scr_rename    = cl_rename;
         gp->scr_screen    = cl_screen;
@@ -0,0 +1,220 @@
+/*-
+ * See the LICENSE.md file for redistribution information.
+ */
+
+#include <sys/types.h>
+#include <sys/queue.h>
+
+#include <bitstring.h>
+#include <curses.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <bsd_stdlib.h>
+#include <bsd_string.h>
+#include <bsd_termios.h>
+#if defined(__GNU_LIBRARY__) && defined(__GLIBC_PREREQ)
+# include <termio.h>
+#endif /* if defined(__GNU_LIBRARY__) && defined(__GLIBC_PREREQ) */
+#include <bsd_unistd.h>
+
+#include "../common/common.h"
+#include "cl.h"
+
+/*
+ * The terminal output layer.
+ *
+ * Everything the editor writes to the terminal outside of curses --
+ * terminfo strings sent through tputs(3), the ex output stream, the bell
+ * and xterm title sequences -- is accumulated in a single buffer and
+ * written with a single write(2) at the end of the screen update, rather
+ * than a stdio flush per string.  The vi screen is drawn by curses, which
+ * writes to the terminal itself and isn't buffered or counted here.  The
+ * buffer is always flushed before handing control to curses, which keeps
+ * the two output streams in order.
+ *
+ * The bytes and writes of this output are counted for each update, and
+ * ":display output" shows the counts.
+ */
+#define CL_OBUF_MIN     1024            /* Initial buffer size. */
+#define CL_OBUF_MAX     (64 * 1024)     /* Flush at this many bytes. */
+
+static void cl_owrite(CL_PRIVATE *, const char *, size_t);
+
+/*
+ * cl_oadd --
+ *      Append bytes to the pending terminal output.
+ *
+ * PUBLIC: void cl_oadd(CL_PRIVATE *, const char *, size_t);
+ */
+void
+cl_oadd(CL_PRIVATE *clp, const char *str, size_t len)
+{
+        size_t nlen;
+        char *p;
+
+        /*
+         * Anything written to stdout by stdio precedes us, get it out of
+         * the way.  This is free if there's nothing buffered.
+         */
+        (void)fflush(stdout);
+
+        if (clp->obuf_len + len > CL_OBUF_MAX)
+                cl_oflush(clp);
+
+        if (clp->obuf_len + len > clp->obuf_size) {
+                nlen = clp->obuf_size == 0 ? CL_OBUF_MIN : clp->obuf_size;
+                while (nlen < clp->obuf_len + len)
+                        nlen <<= 1;
+                if ((p = realloc(clp->obuf, nlen)) == NULL) {
+                        /* Out of memory, write it out unbuffered. */
+                        cl_oflush(clp);
+                        cl_owrite(clp, str, len);
+                        return;
+                }
+                clp->obuf = p;
+                clp->obuf_size = nlen;
+        }
+        memcpy(clp->obuf + clp->obuf_len, str, len);
+        clp->obuf_len += len;
+}
+
+/*
+ * cl_oprintf --
+ *      Append formatted output to the pending terminal output.
+ *
+ * PUBLIC: void cl_oprintf(CL_PRIVATE *, const char *, ...);
+ */
+void
+cl_oprintf(CL_PRIVATE *clp, const char *fmt, ...)
+{
+        va_list ap;
+        char buf[1024], *p;
+        int len;
+
+        va_start(ap, fmt);
+        len = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (len < 0)
+                return;
+        if ((size_t)len < sizeof(buf)) {
+                cl_oadd(clp, buf, len);
+                return;
+        }
+
+        if ((p = malloc(len + 1)) == NULL)
+                return;
+        va_start(ap, fmt);
+        (void)vsnprintf(p, len + 1, fmt, ap);
+        va_end(ap);
+        cl_oadd(clp, p, len);
+        free(p);
+}
+
+/*
+ * cl_oflush --
+ *      Write the pending terminal output.
+ *
+ * PUBLIC: void cl_oflush(CL_PRIVATE *);
+ */
+void
+cl_oflush(CL_PRIVATE *clp)
+{
+        if (clp->obuf_len == 0)
+                return;
+        cl_owrite(clp, clp->obuf, clp->obuf_len);
+        clp->obuf_len = 0;
+}
+
+/*
+ * cl_oupdate --
+ *      End a screen update: write the pending terminal output and close
+ *      out the update's statistics.
+ *
+ * PUBLIC: void cl_oupdate(SCR *);
+ */
+void
+cl_oupdate(SCR *sp)
+{
+        CL_PRIVATE *clp;
+        CL_OSTAT *osp;
+
+        clp = CLP(sp);
+        cl_oflush(clp);
+
+        osp = &clp->ostat;
+        if (osp->o_writes == 0)
+                return;
+
+#ifdef DEBUG
+        TRACE(sp, "output: update %lu: %lu bytes, %lu writes\n",
+            osp->o_updates + 1, osp->o_bytes, osp->o_writes);
+#endif /* ifdef DEBUG */
+
+        ++osp->o_updates;
+        if (osp->o_bytes > osp->o_mbytes)
+                osp->o_mbytes = osp->o_bytes;
+        osp->o_lbytes = osp->o_bytes;
+        osp->o_lwrites = osp->o_writes;
+        osp->o_bytes = osp->o_writes = 0;
+}
+
+/*
+ * cl_ostat --
+ *      Display the terminal output statistics.
+ *
+ * PUBLIC: int cl_ostat(SCR *);
+ */
+int
+cl_ostat(SCR *sp)
+{
+        CL_OSTAT *osp;
+
+        osp = &CLP(sp)->ostat;
+        (void)ex_printf(sp, "Screen updates: %lu\n", osp->o_updates);
+        (void)ex_printf(sp, "Last update: %lu bytes, %lu writes\n",
+            osp->o_lbytes, osp->o_lwrites);
+        (void)ex_printf(sp, "Largest update: %lu bytes\n", osp->o_mbytes);
+        (void)ex_printf(sp, "Total: %lu bytes, %lu writes\n",
+            osp->o_tbytes, osp->o_twrites);
+        return (0);
+}
+
+/*
+ * cl_owrite --
+ *      Write bytes to the terminal, counting the bytes and system calls.
+ */
+static void
+cl_owrite(CL_PRIVATE *clp, const char *str, size_t len)
+{
+        struct pollfd pfd;
+        CL_OSTAT *osp;
+        ssize_t nw;
+
+        osp = &clp->ostat;
+        while (len > 0) {
+                nw = write(STDOUT_FILENO, str, len);
+                ++osp->o_writes;
+                ++osp->o_twrites;
+                if (nw == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        /* Wait for a non-blocking terminal to drain. */
+                        if (errno == EAGAIN) {
+                                pfd.fd = STDOUT_FILENO;
+                                pfd.events = POLLOUT;
+                                if (poll(&pfd, 1, -1) != -1 ||
+                                    errno == EINTR)
+                                        continue;
+                        }
+                        /* Nothing useful to do; drop the output. */
+                        return;
+                }
+                str += nw;
+                len -= nw;
+                osp->o_bytes += nw;
+                osp->o_tbytes += nw;
+        }
+}
@@ -25,6 +25,7 @@
 #include <bsd_stdlib.h>
 #include <bsd_string.h>
 #include <bsd_termios.h>
+#include <time.h>
 #if defined(__GNU_LIBRARY__) && defined(__GLIBC_PREREQ)
 # include <termio.h>
 #endif /* if defined(__GNU_LIBRARY__) && defined(__GLIBC_PREREQ) */
@@ -34,9 +35,15 @@
 #include "../ex/script.h"
 #include "cl.h"
 
+static int      cl_paste(SCR *, EVENT *);
+static size_t   cl_pscan(CL_PRIVATE *, int *);
 static input_t  cl_read(SCR *,
                     u_int32_t, CHAR_T *, size_t, int *, struct timeval *);
 static int      cl_resize(SCR *, size_t, size_t);
+static input_t  cl_wait(SCR *, struct timeval *);
+
+/* Wait this long for the rest of a paste before giving up on it. */
+#define PASTE_TIMEOUT   1000
 
 /*
  * cl_event --
@@ -49,8 +56,8 @@ cl_event(SCR *sp, EVENT *evp, u_int32_t flags, int ms)
 {
         struct timeval t, *tp;
         CL_PRIVATE *clp;
-        size_t lines, columns;
-        int changed, nr;
+        size_t lines, columns, n;
+        int changed, nr, partial;
 
         /*
          * Queue signal based events.  We never clear SIGHUP or SIGTERM events,
@@ -87,6 +94,32 @@ retest: if (LF_ISSET(EC_INTERRUPT) || cl_sigint) {
                 /* No real change, ignore the signal. */
         }
 
+        /* Finish the screen update before waiting for the user. */
+        cl_oupdate(sp);
+
+        /*
+         * Return any input left over from the last read, up to the start of
+         * a paste.  If all that's left might be the beginning of the paste
+         * start marker, wait briefly for the rest of it.
+         */
+        if (clp->ilen != 0) {
+                if ((n = cl_pscan(clp, &partial)) != 0)
+                        goto input;
+                if (!partial) {
+                        if (cl_paste(sp, evp))
+                                return (1);
+                        if (evp->e_len != 0)
+                                return (0);
+                        free(evp->e_asp);
+                        goto retest;
+                }
+
+                memmove(clp->ibuf, clp->ibuf + clp->ioff, clp->ilen);
+                clp->ioff = 0;
+                if (ms == 0 || ms > O_VAL(sp, O_ESCAPETIME) * 100)
+                        ms = O_VAL(sp, O_ESCAPETIME) * 100;
+        }
+
         /* Set timer. */
         if (ms == 0)
                 tp = NULL;
@@ -97,28 +130,148 @@ retest: if (LF_ISSET(EC_INTERRUPT) || cl_sigint) {
         }
 
         /* Read input characters. */
-        switch (cl_read(sp, LF_ISSET(EC_QUOTED | EC_RAW),
-            clp->ibuf, sizeof(clp->ibuf), &nr, tp)) {
+        switch (cl_read(sp, LF_ISSET(EC_QUOTED | EC_RAW), clp->ibuf +
+            clp->ilen, sizeof(clp->ibuf) - clp->ilen, &nr, tp)) {
         case INP_OK:
-                evp->e_csp = clp->ibuf;
-                evp->e_len = nr;
-                evp->e_event = E_STRING;
-                break;
+                clp->ilen += nr;
+                goto retest;
         case INP_EOF:
+                if ((n = clp->ilen) != 0)
+                        goto input;
                 evp->e_event = E_EOF;
                 break;
         case INP_ERR:
+                if ((n = clp->ilen) != 0)
+                        goto input;
                 evp->e_event = E_ERR;
                 break;
         case INP_INTR:
                 goto retest;
         case INP_TIMEOUT:
+                if ((n = clp->ilen) != 0)
+                        goto input;
                 evp->e_event = E_TIMEOUT;
                 break;
         default:
                 abort();
         }
         return (0);
+
+input:  evp->e_csp = clp->ibuf + clp->ioff;
+        evp->e_len = n;
+        evp->e_event = E_STRING;
+        if ((clp->ilen -= n) == 0)
+                clp->ioff = 0;
+        else
+                clp->ioff += n;
+        return (0);
+}
+
+/*
+ * cl_pscan --
+ *      Return the length of the unreturned input preceding the start of
+ *      a paste.  Set *partialp if the input ends with what might be the
+ *      first part of the paste start marker, rather than the whole thing.
+ */
+static size_t
+cl_pscan(CL_PRIVATE *clp, int *partialp)
+{
+        CHAR_T *p, *s;
+        size_t len, mlen, n;
+        char *m;
+
+        *partialp = 0;
+        if (!F_ISSET(clp, CL_BPASTE))
+                return (clp->ilen);
+
+        m = clp->ps != NULL ? clp->ps : BPASTE_START;
+        mlen = strlen(m);
+        s = clp->ibuf + clp->ioff;
+        len = clp->ilen;
+        for (p = s; (p = memchr(p, m[0], len - (p - s))) != NULL; ++p) {
+                n = len - (p - s);
+                if (n >= mlen) {
+                        if (!memcmp(p, m, mlen))
+                                break;
+                } else if (n > 1 && !memcmp(p, m, n)) {
+                        *partialp = 1;
+                        break;
+                }
+        }
+        return (p == NULL ? len : (size_t)(p - s));
+}
+
+/*
+ * cl_paste --
+ *      Return a paste, i.e., everything up to the paste end marker, as a
+ *      single event.
+ *
+ * The terminal sends pasted text wrapped in start and end markers when it's
+ * in bracketed paste mode.  Returning the text as a single event, instead of
+ * as keys, lets text input insert it in one piece, without mapping it.  The
+ * unreturned input starts with the start marker.
+ */
+static int
+cl_paste(SCR *sp, EVENT *evp)
+{
+        struct timeval t;
+        CL_PRIVATE *clp;
+        CHAR_T *bp, *p;
+        size_t blen, len, mlen, off;
+        char *m;
+        int nr;
+
+        clp = CLP(sp);
+
+        /* Discard the start marker. */
+        mlen = strlen(clp->ps != NULL ? clp->ps : BPASTE_START);
+        clp->ioff += mlen;
+        clp->ilen -= mlen;
+
+        /* The rest of the unreturned input starts the paste. */
+        bp = NULL;
+        blen = 0;
+        BINC_RET(sp, bp, blen, clp->ilen + sizeof(clp->ibuf));
+        memcpy(bp, clp->ibuf + clp->ioff, clp->ilen);
+        len = clp->ilen;
+        clp->ioff = clp->ilen = 0;
+
+        /*
+         * Read until the end marker shows up.  The marker can be split across
+         * reads, so each search backs up to where the last one couldn't have
+         * seen a complete marker.  If the terminal goes quiet, or there's an
+         * error, return what we have; whatever happened will be reported by
+         * the next read.
+         */
+        m = clp->pe != NULL ? clp->pe : BPASTE_END;
+        mlen = strlen(m);
+        for (off = 0;;) {
+                for (p = bp + off;
+                    (p = memchr(p, m[0], len - (p - bp))) != NULL; ++p)
+                        if (len - (p - bp) >= mlen && !memcmp(p, m, mlen))
+                                break;
+                if (p != NULL) {
+                        /* Anything following the marker is ordinary input. */
+                        clp->ilen = len - (p - bp) - mlen;
+                        memcpy(clp->ibuf, p + mlen, clp->ilen);
+                        len = p - bp;
+                        break;
+                }
+                off = len < mlen ? 0 : len - mlen + 1;
+
+                BINC_RET(sp, bp, blen, len + sizeof(clp->ibuf));
+                t.tv_sec = PASTE_TIMEOUT / 1000;
+                t.tv_usec = (PASTE_TIMEOUT % 1000) * 1000;
+                if (cl_read(sp, 0, bp + len, sizeof(clp->ibuf), &nr, &t)
+                    != INP_OK)
+                        break;
+                len += nr;
+        }
+
+        evp->e_event = E_PASTE;
+        evp->e_asp = evp->e_csp = bp;
+        evp->e_len = len;
+        return (0);
 }
 
 /*
@@ -131,12 +284,9 @@ cl_read(SCR *sp, u_int32_t flags, CHAR_T *bp, size_t blen, int *nrp,
 {
         struct termios term1, term2;
         CL_PRIVATE *clp;
-        GS *gp;
-        struct pollfd pfd[1];
         input_t rval;
-        int nr, term_reset, timeout;
+        int nr, term_reset;
 
-        gp = sp->gp;
         clp = CLP(sp);
         term_reset = 0;
 
@@ -160,26 +310,7 @@ cl_read(SCR *sp, u_int32_t flags, CHAR_T *bp, size_t blen, int *nrp,
         }
 
         /*
-         * 2: A read with an associated timeout, e.g., trying to complete
-         *    a map sequence.  If input exists, we fall into #3.
-         */
-tty_retry:
-        if (tp != NULL) {
-                pfd[0].fd = STDIN_FILENO;
-                pfd[0].events = POLLIN;
-                timeout = tp ? (tp->tv_sec * 1000) + (tp->tv_usec / 1000) : 0;
-                switch (poll(pfd, 1, timeout)) {
-                case 0:
-                        return (INP_TIMEOUT);
-                case -1:
-                        goto err;
-                default:
-                        break;
-                }
-        }
-
-        /*
-         * The user can enter a key in the editor to quote a character.  If we
+         * 2: The user can enter a key in the editor to quote a character.  If we
          * get here and the next key is supposed to be quoted, do what we can.
          * Reset the tty so that the user can enter a ^C, ^Q, ^S.  There's an
          * obvious race here, when the key has already been entered, but there's
@@ -202,16 +333,13 @@ tty_retry:
         }
 
         /*
-         * 3: Wait for input.
-         *
-         * Select on the command input and scripting window file descriptors.
-         * It's ugly that we wait on scripting file descriptors here, but it's
-         * the only way to keep from locking out scripting windows.
+         * 3: Wait for input, with an associated timeout if trying to complete
+         *    a map sequence.  Script window output and timers are handled
+         *    while we wait.
          */
-        if (F_ISSET(gp, G_SCRWIN)) {
-                if (sscr_check_input(sp))
-                        goto err;
-        }
+tty_retry:
+        if ((rval = cl_wait(sp, tp)) != INP_OK)
+                goto done;
 
         /*
          * 4: Read the input.
@@ -267,11 +395,113 @@ err:            if (errno == EINTR)
         }
 
         /* Restore the terminal state if it was modified. */
-        if (term_reset)
+done:   if (term_reset)
                 (void)tcsetattr(STDIN_FILENO, TCSASOFT | TCSADRAIN, &term1);
         return (rval);
 }
 
+/*
+ * cl_wait --
+ *      Wait for the command input to be readable.
+ *
+ * This is the editor's event loop: everything that happens while the editor
+ * is idle happens here, in one poll(2) of the command input and scripting
+ * window file descriptors that sleeps until the earlier of the caller's
+ * timeout and the next timer.  Script window output is inserted as it comes
+ * in, but never ahead of the command input.  Timers are run once they're
+ * due, keys or no keys, so a steady stream of input can't postpone them
+ * forever.  When nothing is pending, the editor sleeps until a key arrives.
+ */
+static input_t
+cl_wait(SCR *sp, struct timeval *tp)
+{
+        struct pollfd *pfd;
+        struct timespec end, now, ts;
+        CL_PRIVATE *clp;
+        GS *gp;
+        SCR *tsp;
+        size_t nfds;
+        int ms, tms;
+
+        gp = sp->gp;
+        clp = CLP(sp);
+        if (tp != NULL) {
+                ts.tv_sec = tp->tv_sec;
+                ts.tv_nsec = tp->tv_usec * 1000;
+                (void)clock_gettime(CLOCK_MONOTONIC, &end);
+                timespecadd(&end, &ts, &end);
+        }
+
+        for (;;) {
+                /* The command input, followed by the scripting windows. */
+                nfds = 1;
+                if (F_ISSET(gp, G_SCRWIN))
+                        TAILQ_FOREACH(tsp, &gp->dq, q)
+                                if (F_ISSET(tsp, SC_SCRIPT))
+                                        ++nfds;
+                if (nfds > clp->pfd_len) {
+                        if ((pfd = reallocarray(clp->pfd,
+                            nfds, sizeof(struct pollfd))) == NULL) {
+                                msgq(sp, M_SYSERR, NULL);
+                                return (INP_ERR);
+                        }
+                        clp->pfd = pfd;
+                        clp->pfd_len = nfds;
+                }
+                pfd = clp->pfd;
+                pfd[0].fd = STDIN_FILENO;
+                pfd[0].events = POLLIN;
+                if (nfds > 1) {
+                        nfds = 1;
+                        TAILQ_FOREACH(tsp, &gp->dq, q)
+                                if (F_ISSET(tsp, SC_SCRIPT)) {
+                                        pfd[nfds].fd = tsp->script->sh_master;
+                                        pfd[nfds].events = POLLIN;
+                                        ++nfds;
+                                }
+                }
+
+                /* Sleep until the caller's timeout or the next timer. */
+                ms = v_timer_next(gp);
+                if (tp != NULL) {
+                        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+                        if (timespeccmp(&now, &end, <)) {
+                                timespecsub(&end, &now, &ts);
+                                tms = ts.tv_sec * 1000 +
+                                    (ts.tv_nsec + 999999) / 1000000;
+                        } else
+                                tms = 0;
+                        if (ms == -1 || tms < ms)
+                                ms = tms;
+                }
+
+                switch (poll(pfd, nfds, ms)) {
+                case -1:
+                        if (errno == EINTR)
+                                return (INP_INTR);
+                        msgq(sp, M_SYSERR, "poll");
+                        return (INP_ERR);
+                case 0:
+                        break;
+                default:
+                        if (pfd[0].revents == 0 && sscr_input(sp))
+                                return (INP_ERR);
+                        break;
+                }
+
+                /* Timers that are due run even if keys are waiting. */
+                v_timer_run(sp);
+                if (pfd[0].revents != 0)
+                        return (INP_OK);
+                if (tp != NULL) {
+                        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+                        if (!timespeccmp(&now, &end, <))
+                                return (INP_TIMEOUT);
+                }
+        }
+        /* NOTREACHED */
+}
+
 /*
  * cl_resize --
  *      Reset the options for a resize event.
@@ -91,6 +91,8 @@ cl_screen(SCR *sp, u_int32_t flags)
         if (F_ISSET(sp, SC_SCR_VI)) {
                 F_CLR(sp, SC_SCR_VI);
 
+                cl_bpaste(clp, 0);
+                cl_oflush(clp);
                 if (TAILQ_NEXT(sp, q)) {
                         (void)move(RLNO(sp, sp->rows), 0);
                         clrtobot();
@@ -143,6 +145,9 @@ cl_quit(GS *gp)
         if (!F_ISSET(clp, CL_SCR_EX_INIT | CL_SCR_VI_INIT))
                 return (0);
 
+        /* Write any pending output before curses shuts down. */
+        cl_oflush(clp);
+
         /* Clean up the terminal mappings. */
         if (cl_term_end(gp))
                 rval = 1;
@@ -232,9 +237,17 @@ cl_vi_init(SCR *sp)
          */
         (void)del_curterm(cur_term);
 
+        /* Curses is about to write to the terminal. */
+        cl_oflush(clp);
+
         /*
          * We don't care about the SCREEN reference returned by newterm, we
          * never have more than one SCREEN at a time.
+         *
+         * Curses gets stdout rather than a stream into our output buffer:
+         * ncurses writes with write(2) on the stream's file descriptor and
+         * sets the terminal modes through it, and a stream without one,
+         * e.g., from fopencookie(3), leaves the screen blank.
          */
         errno = 0;
         if (newterm(ttype, stdout, stdin) == NULL) {
@@ -359,6 +372,21 @@ cl_vi_init(SCR *sp)
         if (cl_term_init(sp))
                 goto err;
 
+        /*
+         * Get the bracketed paste strings.  The enable and disable strings
+         * are paired, the markers default to the xterm ones.
+         */
+        (void)cl_getcap(sp, "BE", &clp->be);
+        (void)cl_getcap(sp, "BD", &clp->bd);
+        (void)cl_getcap(sp, "PS", &clp->ps);
+        (void)cl_getcap(sp, "PE", &clp->pe);
+        if (clp->be == NULL || clp->bd == NULL) {
+                free(clp->be);
+                clp->be = NULL;
+                free(clp->bd);
+                clp->bd = NULL;
+        }
+
 fast:   /* Set the terminal modes. */
         if (tcsetattr(STDIN_FILENO, TCSASOFT | TCSADRAIN, &clp->vi_enter)) {
                 if (errno == EINTR)
@@ -367,6 +395,9 @@ fast:   /* Set the terminal modes. */
 err:            (void)cl_vi_end(sp->gp);
                 return (1);
         }
+
+        if (O_ISSET(sp, O_BRACKETPASTE))
+                cl_bpaste(clp, 1);
         return (0);
 }
 
@@ -384,6 +415,10 @@ cl_vi_end(GS *gp)
         /* Restore the cursor keys to normal mode. */
         (void)keypad(stdscr, FALSE);
 
+        /* Turn off bracketed paste mode. */
+        cl_bpaste(clp, 0);
+        cl_oflush(clp);
+
         /*
          * If we were running vi when we quit, scroll the screen up a single
          * line so we don't lose any information.
@@ -431,8 +466,11 @@ cl_ex_init(SCR *sp)
         if (F_ISSET(clp, CL_SCR_EX_INIT))
                 goto fast;
 
-        /* If not reading from a file, we're done. */
-        if (!F_ISSET(clp, CL_STDIN_TTY))
+        /*
+         * If not reading from a file, we're done.  Batch sessions don't
+         * use the terminal, and never set it up.
+         */
+        if (!F_ISSET(clp, CL_STDIN_TTY) || F_ISSET(sp->gp, G_BATCH))
                 return (0);
 
         /* Get the ex termcap/terminfo strings. */
@@ -531,6 +569,34 @@ cl_freecap(CL_PRIVATE *clp)
         clp->rmso = NULL;
         free(clp->smso);
         clp->smso = NULL;
+        free(clp->be);
+        clp->be = NULL;
+        free(clp->bd);
+        clp->bd = NULL;
+        free(clp->ps);
+        clp->ps = NULL;
+        free(clp->pe);
+        clp->pe = NULL;
+}
+
+/*
+ * cl_bpaste --
+ *      Turn the terminal's bracketed paste mode on or off.
+ *
+ * PUBLIC: void cl_bpaste(CL_PRIVATE *, int);
+ */
+void
+cl_bpaste(CL_PRIVATE *clp, int on)
+{
+        if (clp->be == NULL || !on == !F_ISSET(clp, CL_BPASTE))
+                return;
+        if (on) {
+                (void)tputs(clp->be, 1, cl_putchar);
+                F_SET(clp, CL_BPASTE);
+        } else {
+                (void)tputs(clp->bd, 1, cl_putchar);
+                F_CLR(clp, CL_BPASTE);
+        }
 }
 
 /*
@@ -143,7 +143,7 @@ cl_term_end(GS *gp)
         for (qp = LIST_FIRST(&gp->seqq); qp != NULL; qp = nqp) {
                 nqp = LIST_NEXT(qp, q);
                 if (F_ISSET(qp, SEQ_SCREEN))
-                        (void)seq_mdel(qp);
+                        (void)seq_mdel(gp, qp);
         }
         return (0);
 }
@@ -220,6 +220,10 @@ cl_optchange(SCR *sp, int opt, char *str, u_long *valp)
                  */
                 F_SET(sp->gp, G_SRESTART);
                 break;
+        case O_BRACKETPASTE:
+                if (F_ISSET(sp, SC_SCR_VI))
+                        cl_bpaste(clp, !*valp);
+                break;
         case O_MESG:
                 (void)cl_omesg(sp, clp, !*valp);
                 break;
@@ -420,5 +424,9 @@ noterm: if (row == 0)
 int
 cl_putchar(int ch)
 {
-        return (putchar(ch));
+        char c;
+
+        c = ch;
+        cl_oadd(GCLP(__global_list), &c, 1);
+        return (ch);
 }
@@ -0,0 +1,472 @@
+/*-
+ * See the LICENSE.md file for redistribution information.
+ */
+
+#include "../include/compat.h"
+
+#include <sys/types.h>
+#include <sys/queue.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <bitstring.h>
+#include <bsd_err.h>
+#include <errno.h>
+#include <bsd_fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <bsd_stdlib.h>
+#include <bsd_string.h>
+#include <time.h>
+#include <bsd_unistd.h>
+
+#include "common.h"
+
+#undef open
+
+/*
+ * Ex batch sessions, "ex -b script file ...".
+ *
+ * The script is run against each file in turn, as if each file had been
+ * edited with "ex -s file < script".  With -j, the files are handed out
+ * to a pool of worker processes, one at a time, through a shared pipe.
+ * Each worker collects the output of a file in temporary files and sends
+ * it back to the parent, which writes it out in the order the files were
+ * given, so the output is the same as a single process would produce.
+ */
+
+/* The result of a file, as sent from a worker to the parent. */
+typedef struct _batch_rec {
+        u_int    idx;                   /* Index of the file. */
+        int      failed;                /* If the script failed. */
+        size_t   olen;                  /* Length of the standard output. */
+        size_t   elen;                  /* Length of the standard error. */
+} BATCH_REC;
+
+/* A file's saved output, waiting for the files before it. */
+typedef struct _batch_out {
+        char    *bp;                    /* Output, then error text. */
+        size_t   olen;                  /* Length of the standard output. */
+        size_t   elen;                  /* Length of the standard error. */
+        int      done;                  /* If the file's finished. */
+        int      failed;                /* If the script failed. */
+} BATCH_OUT;
+
+/* The parent's end of a worker. */
+typedef struct _batch_job {
+        pid_t    pid;                   /* Process ID. */
+        int      fd;                    /* Result pipe, -1 if closed. */
+        char    *bp;                    /* Unparsed results. */
+        size_t   blen;                  /* Buffer length. */
+        size_t   len;                   /* Bytes in the buffer. */
+} BATCH_JOB;
+
+/* Indices to hand out per write; the write has to be atomic. */
+#define BATCH_NIDX      (512 / sizeof(u_int))
+
+static int       batch_file(SCR *, char *, char *, char *, size_t, char *);
+static int       batch_jobs(SCR *, char *, char *, char *, size_t, char *[],
+                    u_int, int);
+static void      batch_out(int, char *, size_t);
+static __dead void batch_worker(SCR *, char *, char *, char *, size_t,
+                    char *[], int, int);
+
+/*
+ * batch --
+ *      Run an ex script against each of a list of files.
+ *
+ * PUBLIC: int batch(SCR *, char *, char *[], int);
+ */
+int
+batch(SCR *sp, char *script, char *argv[], int jobs)
+{
+        struct stat sb;
+        ssize_t nr;
+        size_t len;
+        u_int nfiles;
+        int fd, rval;
+        char *bp, *cp;
+
+        /*
+         * Read the script once.  The parser writes into the commands it's
+         * running, so each file gets a fresh copy of the text.
+         */
+        bp = cp = NULL;
+        if ((fd = open(script, O_RDONLY)) == -1 || fstat(fd, &sb) == -1)
+                goto serr;
+        len = sb.st_size;
+        if ((bp = malloc(len + 1)) == NULL || (cp = malloc(len + 1)) == NULL)
+                goto serr;
+        if ((nr = read(fd, bp, len)) == -1 || (size_t)nr != len) {
+                if (nr != -1)
+                        errno = EIO;
+serr:           warn("%s", script);
+                if (fd != -1)
+                        (void)close(fd);
+                free(bp);
+                free(cp);
+                return (1);
+        }
+        (void)close(fd);
+
+        for (nfiles = 0; argv[nfiles] != NULL; ++nfiles);
+        if (jobs > 1 && nfiles > 1)
+                rval = batch_jobs(sp, script, bp, cp, len, argv, nfiles,
+                    (u_int)jobs < nfiles ? jobs : (int)nfiles);
+        else
+                for (rval = 0; *argv != NULL; ++argv)
+                        if (batch_file(sp, script, bp, cp, len, *argv))
+                                rval = 1;
+        free(bp);
+        free(cp);
+        return (rval);
+}
+
+/*
+ * batch_file --
+ *      Run the script against a file, and report how long it took on the
+ *      standard error.
+ */
+static int
+batch_file(SCR *sp, char *script, char *bp, char *cp, size_t len, char *name)
+{
+        struct timespec start, end;
+        FREF *frp;
+        u_long usec;
+        int failed;
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &start);
+
+        /* Any changes the script didn't write are discarded. */
+        failed = (frp = file_add(sp, name)) == NULL ||
+            file_init(sp, frp, NULL, FS_FORCE);
+        if (!failed) {
+                memcpy(cp, bp, len);
+                failed = ex_run_str(sp, script, cp, len, 1, 1) || ex_cmd(sp);
+        }
+        F_CLR(sp, SC_EXIT | SC_EXIT_FORCE);
+        (void)ex_fflush(sp);
+        if (F_ISSET(sp, SC_SCR_EX))
+                (void)sp->gp->scr_refresh(sp, 0);
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &end);
+        usec = (end.tv_sec - start.tv_sec) * 1000000 +
+            (end.tv_nsec - start.tv_nsec) / 1000;
+        (void)fprintf(stderr, "%s: %s %lu.%06lus\n", name,
+            failed ? "failed" : "ok", usec / 1000000, usec % 1000000);
+        return (failed);
+}
+
+/*
+ * batch_jobs --
+ *      Run the script against the files in a pool of worker processes.
+ */
+static int
+batch_jobs(SCR *sp, char *script, char *bp, char *cp, size_t len,
+    char *argv[], u_int nfiles, int jobs)
+{
+        struct pollfd *pfd;
+        struct sigaction act, oact;
+        BATCH_JOB *jp, *job;
+        BATCH_OUT *op, *out;
+        BATCH_REC rec;
+        ssize_t nr, nw;
+        u_int idx[BATCH_NIDX], n, next, nout;
+        int i, live, rval, tfd[2], rfd[2];
+        char *p;
+
+        rval = 1;
+        job = NULL;
+        out = NULL;
+        pfd = NULL;
+        tfd[0] = tfd[1] = -1;
+        if ((job = calloc(jobs, sizeof(BATCH_JOB))) == NULL ||
+            (out = calloc(nfiles, sizeof(BATCH_OUT))) == NULL ||
+            (pfd = calloc(jobs + 1, sizeof(struct pollfd))) == NULL) {
+                warn(NULL);
+                goto err;
+        }
+        for (i = 0; i < jobs; ++i)
+                job[i].fd = -1;
+
+        /*
+         * The files are handed out through a single pipe, which all of the
+         * workers read, so a worker that finishes early takes the next file.
+         * If the workers all die, the writes fail rather than kill us.
+         */
+        if (pipe(tfd) == -1) {
+                warn("pipe");
+                goto err;
+        }
+        if (fcntl(tfd[1], F_SETFL, fcntl(tfd[1], F_GETFL) | O_NONBLOCK)) {
+                warn("fcntl");
+                (void)close(tfd[0]);
+                (void)close(tfd[1]);
+                goto err;
+        }
+        act.sa_handler = SIG_IGN;
+        sigemptyset(&act.sa_mask);
+        act.sa_flags = 0;
+        (void)sigaction(SIGPIPE, &act, &oact);
+
+        (void)fflush(stdout);
+        (void)fflush(stderr);
+        for (i = 0, jp = job; i < jobs; ++i, ++jp) {
+                if (pipe(rfd) == -1) {
+                        warn("pipe");
+                        break;
+                }
+                switch (jp->pid = fork()) {
+                case -1:
+                        warn("fork");
+                        (void)close(rfd[0]);
+                        (void)close(rfd[1]);
+                        break;
+                case 0:
+                        (void)close(tfd[1]);
+                        (void)close(rfd[0]);
+                        while (--jp >= job)
+                                if (jp->fd != -1)
+                                        (void)close(jp->fd);
+                        batch_worker(sp,
+                            script, bp, cp, len, argv, tfd[0], rfd[1]);
+                        /* NOTREACHED */
+                default:
+                        (void)close(rfd[1]);
+                        jp->fd = rfd[0];
+                        continue;
+                }
+                break;
+        }
+        (void)close(tfd[0]);
+        if ((jobs = i) == 0) {
+                (void)close(tfd[1]);
+                goto sig;
+        }
+
+        for (next = nout = 0;;) {
+                live = 0;
+                pfd[0].fd = tfd[1];
+                pfd[0].events = POLLOUT;
+                for (i = 0, jp = job; i < jobs; ++i, ++jp) {
+                        pfd[i + 1].fd = jp->fd;
+                        pfd[i + 1].events = POLLIN;
+                        if (jp->fd != -1)
+                                ++live;
+                }
+                if (live == 0)
+                        break;
+                if (poll(pfd, jobs + 1, -1) == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        warn("poll");
+                        break;
+                }
+
+                /* Hand out as many files as the pipe will hold. */
+                if (tfd[1] != -1 && pfd[0].revents != 0) {
+                        for (;;) {
+                                for (n = 0;
+                                    n < BATCH_NIDX && next + n < nfiles; ++n)
+                                        idx[n] = next + n;
+                                if (n == 0 ||
+                                    (nw = write(tfd[1],
+                                    idx, n * sizeof(u_int))) == -1)
+                                        break;
+                                next += nw / sizeof(u_int);
+                        }
+                        if (next == nfiles || (n != 0 && errno != EAGAIN)) {
+                                (void)close(tfd[1]);
+                                tfd[1] = -1;
+                        }
+                }
+
+                /* Collect the results. */
+                for (i = 0, jp = job; i < jobs; ++i, ++jp) {
+                        if (jp->fd == -1 || pfd[i + 1].revents == 0)
+                                continue;
+                        if (jp->blen - jp->len < 64 * 1024) {
+                                if ((p = realloc(jp->bp,
+                                    jp->blen + 64 * 1024)) == NULL) {
+                                        warn(NULL);
+                                        goto kill;
+                                }
+                                jp->bp = p;
+                                jp->blen += 64 * 1024;
+                        }
+                        if ((nr = read(jp->fd,
+                            jp->bp + jp->len, jp->blen - jp->len)) <= 0) {
+                                if (nr == -1 && errno == EINTR)
+                                        continue;
+                                (void)close(jp->fd);
+                                jp->fd = -1;
+                                continue;
+                        }
+                        jp->len += nr;
+
+                        /* Save each whole record. */
+                        while (jp->len >= sizeof(BATCH_REC)) {
+                                memcpy(&rec, jp->bp, sizeof(BATCH_REC));
+                                n = sizeof(BATCH_REC) + rec.olen + rec.elen;
+                                if (jp->len < n)
+                                        break;
+                                if (rec.idx >= nfiles) {
+                                        warnx("batch: bad worker result");
+                                        goto kill;
+                                }
+                                op = out + rec.idx;
+                                if ((op->bp =
+                                    malloc(rec.olen + rec.elen + 1)) == NULL) {
+                                        warn(NULL);
+                                        goto kill;
+                                }
+                                memcpy(op->bp, jp->bp + sizeof(BATCH_REC),
+                                    rec.olen + rec.elen);
+                                op->olen = rec.olen;
+                                op->elen = rec.elen;
+                                op->failed = rec.failed;
+                                op->done = 1;
+                                memmove(jp->bp, jp->bp + n, jp->len - n);
+                                jp->len -= n;
+                        }
+                }
+
+                /* Write out the finished files, in order. */
+                for (; nout < nfiles && out[nout].done; ++nout) {
+                        op = out + nout;
+                        batch_out(STDOUT_FILENO, op->bp, op->olen);
+                        batch_out(STDERR_FILENO, op->bp + op->olen, op->elen);
+                        free(op->bp);
+                        op->bp = NULL;
+                }
+        }
+
+        /*
+         * Any files a worker took but didn't finish, or that weren't handed
+         * out at all, failed.
+         */
+        rval = 0;
+        for (; nout < nfiles; ++nout) {
+                op = out + nout;
+                if (op->done) {
+                        batch_out(STDOUT_FILENO, op->bp, op->olen);
+                        batch_out(STDERR_FILENO, op->bp + op->olen, op->elen);
+                        free(op->bp);
+                        op->bp = NULL;
+                } else {
+                        op->failed = 1;
+                        (void)fprintf(stderr,
+                            "%s: failed (no worker)\n", argv[nout]);
+                }
+        }
+        for (n = 0; n < nfiles; ++n)
+                if (out[n].failed)
+                        rval = 1;
+
+        if (0) {
+kill:           for (i = 0, jp = job; i < jobs; ++i, ++jp)
+                        (void)kill(jp->pid, SIGTERM);
+        }
+        if (tfd[1] != -1)
+                (void)close(tfd[1]);
+        for (i = 0, jp = job; i < jobs; ++i, ++jp) {
+                if (jp->fd != -1)
+                        (void)close(jp->fd);
+                (void)waitpid(jp->pid, NULL, 0);
+        }
+sig:    (void)sigaction(SIGPIPE, &oact, NULL);
+
+err:    if (job != NULL)
+                for (i = 0; i < jobs; ++i)
+                        free(job[i].bp);
+        if (out != NULL)
+                for (n = 0; n < nfiles; ++n)
+                        free(out[n].bp);
+        free(job);
+        free(out);
+        free(pfd);
+        return (rval);
+}
+
+/*
+ * batch_worker --
+ *      Take files from the parent and run the script against them, until
+ *      there are no more files.
+ */
+static void
+batch_worker(SCR *sp, char *script, char *bp, char *cp, size_t len,
+    char *argv[], int tfd, int rfd)
+{
+        struct stat osb, esb;
+        BATCH_REC rec;
+        FILE *efp, *ofp;
+        size_t blen;
+        u_int idx;
+        char *p, *rbp;
+
+        /* Collect each file's output in temporary files. */
+        if ((ofp = tmpfile()) == NULL || (efp = tmpfile()) == NULL ||
+            dup2(fileno(ofp), STDOUT_FILENO) == -1 ||
+            dup2(fileno(efp), STDERR_FILENO) == -1)
+                _exit(1);
+
+        rbp = NULL;
+        blen = 0;
+        while (read(tfd, &idx, sizeof(idx)) == sizeof(idx)) {
+                if (ftruncate(STDOUT_FILENO, 0) == -1 ||
+                    ftruncate(STDERR_FILENO, 0) == -1 ||
+                    lseek(STDOUT_FILENO, 0, SEEK_SET) == -1 ||
+                    lseek(STDERR_FILENO, 0, SEEK_SET) == -1)
+                        _exit(1);
+
+                rec.idx = idx;
+                rec.failed = batch_file(sp, script, bp, cp, len, argv[idx]);
+                (void)fflush(stdout);
+                (void)fflush(stderr);
+
+                if (fstat(STDOUT_FILENO, &osb) == -1 ||
+                    fstat(STDERR_FILENO, &esb) == -1)
+                        _exit(1);
+                rec.olen = osb.st_size;
+                rec.elen = esb.st_size;
+                if (blen < sizeof(BATCH_REC) + rec.olen + rec.elen) {
+                        blen = sizeof(BATCH_REC) + rec.olen + rec.elen;
+                        if ((p = realloc(rbp, blen)) == NULL)
+                                _exit(1);
+                        rbp = p;
+                }
+                memcpy(rbp, &rec, sizeof(BATCH_REC));
+                p = rbp + sizeof(BATCH_REC);
+                if (pread(STDOUT_FILENO, p, rec.olen, 0) != (ssize_t)rec.olen ||
+                    pread(STDERR_FILENO,
+                    p + rec.olen, rec.elen, 0) != (ssize_t)rec.elen)
+                        _exit(1);
+                batch_out(rfd, rbp, sizeof(BATCH_REC) + rec.olen + rec.elen);
+        }
+
+        if (sp->ep != NULL)
+                (void)file_end(sp, NULL, 1);
+        _exit(0);
+}
+
+/*
+ * batch_out --
+ *      Write all of a buffer.
+ */
+static void
+batch_out(int fd, char *p, size_t len)
+{
+        ssize_t nw;
+
+        for (; len > 0; p += nw, len -= nw)
+                if ((nw = write(fd, p, len)) == -1) {
+                        if (errno == EINTR) {
+                                nw = 0;
+                                continue;
+                        }
+                        return;
+                }
+}
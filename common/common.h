@@ -23,23 +23,28 @@
  * are far too interrelated for a clean solution.
  */
 typedef struct _cb              CB;
+typedef struct _cbtext          CBTEXT;
 typedef struct _event           EVENT;
 typedef struct _excmd           EXCMD;
 typedef struct _exf             EXF;
 typedef struct _fref            FREF;
 typedef struct _gs              GS;
 typedef struct _lmark           LMARK;
+typedef struct _log_arena       LOG_ARENA;
 typedef struct _mark            MARK;
 typedef struct _msg             MSGS;
 typedef struct _option          OPTION;
 typedef struct _optlist         OPTLIST;
+typedef struct _rcv_jnl         RCV_JNL;
 typedef struct _scr             SCR;
 typedef struct _script          SCRIPT;
 typedef struct _seq             SEQ;
+typedef struct _seq_node        SEQ_NODE;
 typedef struct _tag             TAG;
 typedef struct _tagf            TAGF;
 typedef struct _tagq            TAGQ;
 typedef struct _text            TEXT;
+typedef struct _timer           TIMER;
 
 /* Autoindent state. */
 typedef enum { C_NOTSET, C_CARATSET, C_NOCHANGE, C_ZEROSET } carat_t;
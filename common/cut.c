@@ -24,6 +24,11 @@
 
 #include "common.h"
 
+#define CB_BLKMIN       256             /* First block size. */
+#define CB_BLKMAX       (1024 * 1024)   /* Largest block size. */
+
+static int      cb_add(SCR *, CB *, const char *, size_t);
+static int      cb_own(SCR *, CB *);
 static void     cb_rotate(SCR *);
 
 /*
@@ -58,21 +63,23 @@ static void     cb_rotate(SCR *);
  * replacing the contents.  Hopefully it's not worth getting right, and here
  * we just treat the numeric buffers like any other named buffer.
  *
+ * The text is cut once, and the buffers it's copied into share it.  A buffer
+ * that's appended to while it's shared gets its own copy of the text first.
+ *
  * PUBLIC: int cut(SCR *, CHAR_T *, MARK *, MARK *, int);
  */
 int
 cut(SCR *sp, CHAR_T *namep, MARK *fm, MARK *tm, int flags)
 {
-        CB *cbp;
+        CB cb, *cbp;
         CHAR_T name = '1';      /* default numeric buffer */
         recno_t lno;
+        size_t cnt;
         int append, copy_one, copy_def;
 
         /*
          * If the user specified a buffer, put it there.  (This may require
-         * a copy into the numeric buffers.  We do the copy so that we don't
-         * have to reference count and so we don't have to deal with things
-         * like appends to buffers that are used multiple times.)
+         * a copy into the numeric buffers, which shares the cut text.)
          *
          * Otherwise, if it's supposed to be put in a numeric buffer (usually
          * a delete) put it there.  The rules for putting things in numeric
@@ -112,27 +119,12 @@ namecb:         CBNAME(sp, cbp, name);
         } else
                 cbp = &sp->gp->dcb_store;
 
-copyloop:
-        /*
-         * If this is a new buffer, create it and add it into the list.
-         * Otherwise, if it's not an append, free its current contents.
-         */
-        if (cbp == NULL) {
-                CALLOC_RET(sp, cbp, 1, sizeof(CB));
-                cbp->name = name;
-                TAILQ_INIT(&cbp->textq);
-                LIST_INSERT_HEAD(&sp->gp->cutq, cbp, q);
-        } else if (!append) {
-                text_lfree(&cbp->textq);
-                cbp->len = 0;
-                cbp->flags = 0;
-        }
-
-        /* In line mode, it's pretty easy, just cut the lines. */
+        /* Cut the text. */
+        memset(&cb, 0, sizeof(cb));
         if (LF_ISSET(CUT_LINEMODE)) {
-                cbp->flags |= CB_LMODE;
+                /* In line mode, it's pretty easy, just cut the lines. */
                 for (lno = fm->lno; lno <= tm->lno; ++lno)
-                        if (cut_line(sp, lno, 0, CUT_LINE_TO_EOL, cbp))
+                        if (cut_line(sp, lno, 0, CUT_LINE_TO_EOL, &cb))
                                 goto cut_line_err;
         } else {
                 /*
@@ -140,20 +132,53 @@ copyloop:
                  * cut_line() to cut from the MARK to the end of the line.
                  */
                 if (cut_line(sp, fm->lno, fm->cno, fm->lno != tm->lno ?
-                    CUT_LINE_TO_EOL : (tm->cno - fm->cno) + 1, cbp))
+                    CUT_LINE_TO_EOL : (tm->cno - fm->cno) + 1, &cb))
                         goto cut_line_err;
 
                 /* Get the intermediate lines. */
                 for (lno = fm->lno; ++lno < tm->lno;)
-                        if (cut_line(sp, lno, 0, CUT_LINE_TO_EOL, cbp))
+                        if (cut_line(sp, lno, 0, CUT_LINE_TO_EOL, &cb))
                                 goto cut_line_err;
 
                 /* Get the last line. */
                 if (tm->lno != fm->lno &&
-                    cut_line(sp, lno, 0, tm->cno + 1, cbp))
+                    cut_line(sp, lno, 0, tm->cno + 1, &cb))
                         goto cut_line_err;
         }
 
+copyloop:
+        /*
+         * If this is a new buffer, create it and add it into the list.
+         * Otherwise, if it's not an append, free its current contents.
+         */
+        if (cbp == NULL) {
+                CALLOC(sp, cbp, 1, sizeof(CB));
+                if (cbp == NULL)
+                        goto cut_line_err;
+                cbp->name = name;
+                LIST_INSERT_HEAD(&sp->gp->cutq, cbp, q);
+        } else if (!append) {
+                cut_free(cbp);
+                cbp->flags = 0;
+        }
+        if (LF_ISSET(CUT_LINEMODE))
+                cbp->flags |= CB_LMODE;
+
+        /* Append a copy of the text, or share it. */
+        if (cbp->text != NULL) {
+                for (cnt = 0; cnt < CB_NLINES(&cb); ++cnt)
+                        if (cb_add(sp, cbp, CB_LINE(&cb, cnt)->lb,
+                            CB_LINE(&cb, cnt)->len)) {
+                                cut_free(cbp);
+                                cbp->flags = 0;
+                                goto cut_line_err;
+                        }
+        } else {
+                cbp->text = cb.text;
+                cbp->len = cb.len;
+                ++cb.text->refcnt;
+        }
+
         append = 0;             /* Only append to the named buffer. */
         sp->gp->dcbp = cbp;     /* Repoint the default buffer on each pass. */
 
@@ -167,12 +192,11 @@ copyloop:
                 copy_def = 0;
                 goto copyloop;
         }
+        cut_free(&cb);
         return (0);
 
 cut_line_err:
-        text_lfree(&cbp->textq);
-        cbp->len = 0;
-        cbp->flags = 0;
+        cut_free(&cb);
         return (1);
 }
 
@@ -218,7 +242,7 @@ cb_rotate(SCR *sp)
                 }
         if (del_cbp != NULL) {
                 LIST_REMOVE(del_cbp, q);
-                text_lfree(&del_cbp->textq);
+                cut_free(del_cbp);
                 free(del_cbp);
         }
 }
@@ -232,7 +256,6 @@ cb_rotate(SCR *sp)
 int
 cut_line(SCR *sp, recno_t lno, size_t fcno, size_t clen, CB *cbp)
 {
-        TEXT *tp;
         size_t len;
         char *p;
 
@@ -240,26 +263,132 @@ cut_line(SCR *sp, recno_t lno, size_t fcno, size_t clen, CB *cbp)
         if (db_get(sp, lno, DBG_FATAL, &p, &len))
                 return (1);
 
-        /* Create a TEXT structure that can hold the entire line. */
-        if ((tp = text_init(sp, NULL, 0, len)) == NULL)
-                return (1);
-
         /*
          * If the line isn't empty and it's not the entire line,
-         * copy the portion we want, and reset the TEXT length.
+         * copy the portion we want.
          */
-        if (len != 0) {
-                if (clen == CUT_LINE_TO_EOL)
-                        clen = len - fcno;
-                memcpy(tp->lb, p + fcno, clen);
-                tp->len = clen;
-        }
+        if (len == 0)
+                clen = 0;
+        else if (clen == CUT_LINE_TO_EOL)
+                clen = len - fcno;
 
         /* Append to the end of the cut buffer. */
-        TAILQ_INSERT_TAIL(&cbp->textq, tp, q);
-        cbp->len += tp->len;
+        return (cb_add(sp, cbp, p + fcno, clen));
+}
+
+/*
+ * cut_free --
+ *      Release a cut buffer's text.
+ *
+ * PUBLIC: void cut_free(CB *);
+ */
+void
+cut_free(CB *cbp)
+{
+        CBTEXT *ctp;
+        size_t cnt;
+
+        if ((ctp = cbp->text) != NULL && --ctp->refcnt == 0) {
+                for (cnt = 0; cnt < ctp->nblocks; ++cnt)
+                        free(ctp->blocks[cnt]);
+                free(ctp->blocks);
+                free(ctp->cbl);
+                free(ctp);
+        }
+        cbp->text = NULL;
+        cbp->len = 0;
+}
+
+/*
+ * cb_own --
+ *      Make sure a cut buffer has text of its own to append to.
+ */
+static int
+cb_own(SCR *sp, CB *cbp)
+{
+        CB cb;
+        size_t cnt;
+
+        if (cbp->text != NULL && cbp->text->refcnt == 1)
+                return (0);
+
+        memset(&cb, 0, sizeof(cb));
+        CALLOC_RET(sp, cb.text, 1, sizeof(CBTEXT));
+        cb.text->refcnt = 1;
+        for (cnt = 0; cnt < CB_NLINES(cbp); ++cnt)
+                if (cb_add(sp, &cb,
+                    CB_LINE(cbp, cnt)->lb, CB_LINE(cbp, cnt)->len)) {
+                        cut_free(&cb);
+                        return (1);
+                }
+        cut_free(cbp);
+        cbp->text = cb.text;
+        cbp->len = cb.len;
+        return (0);
+}
+
+/*
+ * cb_add --
+ *      Append a line to a cut buffer.
+ */
+static int
+cb_add(SCR *sp, CB *cbp, const char *p, size_t len)
+{
+        CBTEXT *ctp;
+        size_t nlen;
+        void *v;
+
+        if (cb_own(sp, cbp))
+                return (1);
+        ctp = cbp->text;
+
+        /* Get another line slot. */
+        if (ctp->nlines == ctp->mlines) {
+                nlen = ctp->mlines == 0 ? 32 : ctp->mlines * 2;
+                if ((v = reallocarray(ctp->cbl,
+                    nlen, sizeof(CBLINE))) == NULL)
+                        goto nomem;
+                ctp->cbl = v;
+                ctp->mlines = nlen;
+        }
 
+        /*
+         * Get another block if the line doesn't fit.  Blocks start small,
+         * as most cuts are, and double in size with each new block.
+         */
+        if (len > ctp->bleft) {
+                if (ctp->nblocks == ctp->mblocks) {
+                        nlen = ctp->mblocks == 0 ? 8 : ctp->mblocks * 2;
+                        if ((v = reallocarray(ctp->blocks,
+                            nlen, sizeof(char *))) == NULL)
+                                goto nomem;
+                        ctp->blocks = v;
+                        ctp->mblocks = nlen;
+                }
+                nlen = ctp->bsize == 0 ? CB_BLKMIN : ctp->bsize * 2;
+                if (nlen > CB_BLKMAX)
+                        nlen = CB_BLKMAX;
+                if (nlen < len)
+                        nlen = len;
+                if ((ctp->bp = malloc(nlen)) == NULL)
+                        goto nomem;
+                ctp->blocks[ctp->nblocks++] = ctp->bp;
+                ctp->bsize = ctp->bleft = nlen;
+        }
+
+        ctp->cbl[ctp->nlines].lb = ctp->bp;
+        ctp->cbl[ctp->nlines].len = len;
+        ++ctp->nlines;
+        if (len != 0) {
+                memcpy(ctp->bp, p, len);
+                ctp->bp += len;
+                ctp->bleft -= len;
+        }
+        cbp->len += len;
         return (0);
+
+nomem:  msgq(sp, M_SYSERR, NULL);
+        return (1);
 }
 
 /*
@@ -275,16 +404,13 @@ cut_close(GS *gp)
 
         /* Free cut buffer list. */
         while ((cbp = LIST_FIRST(&gp->cutq)) != NULL) {
-                if (!TAILQ_EMPTY(&cbp->textq))
-                        text_lfree(&cbp->textq);
+                cut_free(cbp);
                 LIST_REMOVE(cbp, q);
                 free(cbp);
         }
 
         /* Free default cut storage. */
-        cbp = &gp->dcb_store;
-        if (!TAILQ_EMPTY(&cbp->textq))
-                text_lfree(&cbp->textq);
+        cut_free(&gp->dcb_store);
 }
 
 /*
@@ -15,10 +15,31 @@
 typedef struct _texth TEXTH;            /* TEXT list head structure. */
 TAILQ_HEAD(_texth, _text);
 
+/*
+ * Cut buffer text.  The lines are stored end to end in a few large blocks,
+ * with an array describing each line.  The text is reference counted, so a
+ * single cut can be shared by the named, numeric and default buffers.
+ */
+typedef struct {
+        char    *lb;                    /* Line. */
+        size_t   len;                   /* Line length. */
+} CBLINE;
+
+struct _cbtext {
+        CBLINE  *cbl;                   /* Lines. */
+        size_t   nlines, mlines;
+        char   **blocks;                /* Blocks holding the lines. */
+        size_t   nblocks, mblocks;
+        char    *bp;                    /* Next free byte in last block. */
+        size_t   bsize;                 /* Last block size. */
+        size_t   bleft;                 /* Bytes left in last block. */
+        int      refcnt;                /* Reference count. */
+};
+
 /* Cut buffers. */
 struct _cb {
         LIST_ENTRY(_cb) q;              /* Linked list of cut buffers. */
-        TEXTH    textq;                 /* Linked list of TEXT structures. */
+        CBTEXT  *text;                  /* Text, or NULL. */
         CHAR_T   name;                  /* Cut buffer name. */
         size_t   len;                   /* Total length of cut text. */
 
@@ -61,6 +82,10 @@ struct _text {                          /* Text: a linked list of lines. */
         } term;
 };
 
+/* Cut buffer lines. */
+#define CB_NLINES(cbp)  ((cbp)->text == NULL ? 0 : (cbp)->text->nlines)
+#define CB_LINE(cbp, n) (&(cbp)->text->cbl[n])
+
 /*
  * Get named buffer 'name'.
  * Translate upper-case buffer names to lower-case buffer names.
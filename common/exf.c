@@ -129,9 +129,10 @@ file_init(SCR *sp, FREF *frp, char *rcv_name, int flags)
         struct stat sb;
         size_t psize;
         int fd, exists, open_err, readonly;
-        char *oname, tname[] = "/tmp/vi.XXXXXX";
+        char *jname, *oname, tname[] = "/tmp/vi.XXXXXX";
 
         open_err = readonly = 0;
+        jname = NULL;
 
         /*
          * If the file is a recovery file, let the recovery code handle it.
@@ -253,7 +254,12 @@ file_init(SCR *sp, FREF *frp, char *rcv_name, int flags)
         oinfo.flags = F_ISSET(sp->gp, G_SNAPSHOT) ? R_SNAPSHOT : 0;
 #ifndef NO_BFNAME
         if (rcv_name == NULL) {
-                if (!rcv_tmp(sp, ep, frp->name))
+                /*
+                 * Batch sessions aren't recoverable, so they don't need a
+                 * backing file, and keep the file in memory.
+                 */
+                if (!F_ISSET(sp->gp, G_BATCH) &&
+                    !rcv_tmp(sp, ep, frp->name))
                         oinfo.bfname = ep->rcv_path;
         } else {
                 if ((ep->rcv_path = strdup(rcv_name)) == NULL) {
@@ -262,16 +268,24 @@ file_init(SCR *sp, FREF *frp, char *rcv_name, int flags)
                 }
                 oinfo.bfname = ep->rcv_path;
                 F_SET(ep, F_MODIFIED);
+
+                /*
+                 * If there's a journal, read its file into a new b+tree
+                 * and replay it.
+                 */
+                jname = rcv_jopen(sp, ep, &oinfo.bfname);
         }
 #endif /* ifndef NO_BFNAME */
 
         /* Open a db structure. */
-        if ((ep->db = dbopen(rcv_name == NULL ? oname : NULL,
+reopen: if ((ep->db = dbopen(rcv_name == NULL ? oname : jname,
             O_NONBLOCK | O_RDONLY,
             S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH,
             DB_RECNO, &oinfo)) == NULL) {
                 msgq_str(sp,
                     M_SYSERR, rcv_name == NULL ? oname : rcv_name, "%s");
+                if (ep->rcv_jnl != NULL)
+                        goto stale;
                 /*
                  * !!!
                  * Historically, vi permitted users to edit files that couldn't
@@ -282,6 +296,17 @@ file_init(SCR *sp, FREF *frp, char *rcv_name, int flags)
                 open_err = 1;
                 goto oerr;
         }
+        if (ep->rcv_jnl != NULL && rcv_jreplay(sp, ep)) {
+                /* The old b+tree is untouched; recover it instead. */
+                (void)ep->db->close(ep->db);
+                ep->db = NULL;
+stale:          msgq_str(sp, M_ERR, rcv_name,
+                    "%s: recovering a stale copy without the journaled changes");
+                rcv_jend(ep, 1);
+                jname = NULL;
+                oinfo.bfname = ep->rcv_path;
+                goto reopen;
+        }
 
         /*
          * Do the remaining things that can cause failure of the new file,
@@ -438,6 +463,7 @@ oerr:   if (F_ISSET(ep, F_RCV_ON))
                 (void)unlink(ep->rcv_path);
         free(ep->rcv_path);
         ep->rcv_path = NULL;
+        rcv_jend(ep, 0);
         if (ep->db != NULL)
                 (void)ep->db->close(ep->db);
         free(ep);
@@ -713,6 +739,7 @@ file_end(SCR *sp, EXF *ep, int force)
                 if (ep->rcv_mpath != NULL && unlink(ep->rcv_mpath))
                         msgq_str(sp, M_SYSERR, ep->rcv_mpath, "%s: remove");
         }
+        rcv_jend(ep, !F_ISSET(ep, F_RCV_NORM));
         if (ep->fcntl_fd != -1)
                 (void)close(ep->fcntl_fd);
         if (ep->rcv_fd != -1)
@@ -909,6 +936,11 @@ file_write(SCR *sp, MARK *fm, MARK *tm, char *name, int flags)
          */
         if (LF_ISSET(FS_ALL) && !LF_ISSET(FS_APPEND)) {
                 F_CLR(ep, F_MODIFIED);
+
+                /* The file on disk is current, journal changes against it. */
+                if (noname &&
+                    F_ISSET(ep, F_RCV_ON) && !F_ISSET(ep, F_FIRSTMODIFY))
+                        (void)rcv_jstart(sp);
                 if (F_ISSET(frp, FR_TMPFILE)) {
                         if (noname)
                                 F_SET(frp, FR_TMPEXIT);
@@ -26,15 +26,21 @@ struct _exf {
         recno_t  c_lno;                 /* Cached line number. */
         recno_t  c_nlines;              /* Cached lines in the file. */
 
-        DB      *log;                   /* Log db structure. */
+        LOG_ARENA *log;                 /* Log arena. */
         char    *l_lp;                  /* Log buffer. */
         size_t   l_len;                 /* Log buffer length. */
+        char    *l_bp;                  /* Log before image. */
+        size_t   l_blen;                /* Log before image buffer length. */
+        size_t   l_bsize;               /* Log before image length. */
+        recno_t  l_blno;                /* Log before image line number. */
         recno_t  l_high;                /* Log last + 1 record number. */
         recno_t  l_cur;                 /* Log current record number. */
         MARK     l_cursor;              /* Log cursor position. */
         dir_t    lundo;                 /* Last undo direction. */
 
         LIST_HEAD(_markh, _lmark) marks;/* Linked list of file MARK's. */
+        recno_t  m_lo, m_hi;            /* Lowest, highest marked lines. */
+        recno_t  m_off;                 /* Unapplied mark line shift. */
 
         dev_t    mdev;                  /* Device. */
         ino_t    minode;                /* Inode. */
@@ -50,6 +56,8 @@ struct _exf {
         char    *rcv_path;              /* Recover file name. */
         char    *rcv_mpath;             /* Recover mail file name. */
         int      rcv_fd;                /* Locked mail file descriptor. */
+        struct timespec rcv_due;        /* Recover file sync deadline. */
+        RCV_JNL *rcv_jnl;               /* Recover file journal. */
 
 #define F_DEVSET        0x001           /* mdev/minode fields initialized. */
 #define F_FIRSTMODIFY   0x002           /* File not yet modified. */
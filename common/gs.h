@@ -99,17 +99,21 @@ struct _gs {
         FILE    *tracefp;               /* Trace file pointer. */
 #endif /* ifdef DEBUG */
 
-        EVENT   *i_event;               /* Array of input events. */
+        EVENT   *i_event;               /* Circular array of input events. */
         size_t   i_nelem;               /* Number of array elements. */
         size_t   i_cnt;                 /* Count of events. */
         size_t   i_next;                /* Offset of next event. */
 
+        LIST_HEAD(_timerh, _timer) timerq;/* Pending timers, by deadline. */
+
         CB      *dcbp;                  /* Default cut buffer pointer. */
         CB       dcb_store;             /* Default cut buffer storage. */
         LIST_HEAD(_cuth, _cb) cutq;     /* Linked list of cut buffers. */
 
 #define MAX_BIT_SEQ     128             /* Max + 1 fast check character. */
         LIST_HEAD(_seqh, _seq) seqq;    /* Linked list of maps, abbrevs. */
+        SEQ_NODE *seqt[SEQ_INPUT + 1];  /* Maps, abbrevs tries, by type. */
+        size_t   seqmax;                /* Longest map, abbrev input. */
         bitstr_t bit_decl(seqb, MAX_BIT_SEQ);
 
 #define MAX_FAST_KEY    254             /* Max fast check character.*/
@@ -139,14 +143,15 @@ struct _gs {
 
 /* Flags. */
 #define G_ABBREV        0x0001          /* If have abbreviations. */
-#define G_BELLSCHED     0x0002          /* Bell scheduled. */
-#define G_INTERRUPTED   0x0004          /* Interrupted. */
-#define G_RECOVER_SET   0x0008          /* Recover system initialized. */
-#define G_SCRIPTED      0x0010          /* Ex script session. */
-#define G_SCRWIN        0x0020          /* Scripting windows running. */
-#define G_SNAPSHOT      0x0040          /* Always snapshot files. */
-#define G_SRESTART      0x0080          /* Screen restarted. */
-#define G_TMP_INUSE     0x0100          /* Temporary buffer in use. */
+#define G_BATCH         0x0002          /* Ex -b batch session. */
+#define G_BELLSCHED     0x0004          /* Bell scheduled. */
+#define G_INTERRUPTED   0x0008          /* Interrupted. */
+#define G_RECOVER_SET   0x0010          /* Recover system initialized. */
+#define G_SCRIPTED      0x0020          /* Ex script session. */
+#define G_SCRWIN        0x0040          /* Scripting windows running. */
+#define G_SNAPSHOT      0x0080          /* Always snapshot files. */
+#define G_SRESTART      0x0100          /* Screen restarted. */
+#define G_TMP_INUSE     0x0200          /* Temporary buffer in use. */
         u_int32_t flags;
 
         /* Screen interface functions. */
@@ -180,6 +185,8 @@ struct _gs {
         int     (*scr_insertln)(SCR *);
                                         /* Handle an option change. */
         int     (*scr_optchange)(SCR *, int, char *, u_long *);
+                                        /* Display output statistics. */
+        int     (*scr_ostat)(SCR *);
                                         /* Move the cursor. */
         int     (*scr_move)(SCR *, size_t, size_t);
                                         /* Message or ex output. */
@@ -21,19 +21,26 @@
 #include <stdio.h>
 #include <bsd_stdlib.h>
 #include <bsd_string.h>
+#include <time.h>
 #include <bsd_unistd.h>
 
 #include "common.h"
 #include "../vi/vi.h"
 
 #define MAXIMUM(a, b)   (((a) > (b)) ? (a) : (b))
+#define MINIMUM(a, b)   (((a) < (b)) ? (a) : (b))
 
 static int      v_event_append(SCR *, EVENT *);
-static int      v_event_grow(SCR *, int);
+static int      v_event_grow(SCR *, size_t);
 static int      v_key_cmp(const void *, const void *);
 static void     v_keyval(SCR *, int, scr_keyval_t);
 static void     v_sync(SCR *, int);
 
+/* Offset of the n'th event in the queue. */
+#define QOFF(gp, n)                                                     \
+        ((gp)->i_next + (n) >= (gp)->i_nelem ?                          \
+            (gp)->i_next + (n) - (gp)->i_nelem : (gp)->i_next + (n))
+
 /*
  * !!!
  * Historic vi always used:
@@ -318,6 +325,10 @@ v_key_val(SCR *sp, CHAR_T ch)
  * an associated flag value, which indicates if it has already been quoted,
  * and if it is the result of a mapping or an abbreviation.
  *
+ * The buffer is circular, so neither end ever has to be shifted to make
+ * room at the other; executing a large buffer or a map that expands into
+ * more maps doesn't copy the rest of the queue each time.
+ *
  * PUBLIC: int v_event_push(SCR *, EVENT *, CHAR_T *, size_t, u_int);
  */
 int
@@ -325,46 +336,31 @@ v_event_push(SCR *sp, EVENT *p_evp, CHAR_T *p_s, size_t nitems, u_int flags)
 {
         EVENT *evp;
         GS *gp;
-        size_t total;
+        size_t off;
 
-        /* If we have room, stuff the items into the buffer. */
         gp = sp->gp;
-        if (nitems <= gp->i_next ||
-            (gp->i_event != NULL && gp->i_cnt == 0 && nitems <= gp->i_nelem)) {
-                if (gp->i_cnt != 0)
-                        gp->i_next -= nitems;
-                goto copy;
-        }
-
-        /*
-         * If there are currently items in the queue, shift them up,
-         * leaving some extra room.  Get enough space plus a little
-         * extra.
-         */
-#define TERM_PUSH_SHIFT 30
-        total = gp->i_cnt + gp->i_next + nitems + TERM_PUSH_SHIFT;
-        if (total >= gp->i_nelem && v_event_grow(sp, MAXIMUM(total, 64)))
-                return (1);
-        if (gp == NULL)
+        if (nitems > gp->i_nelem - gp->i_cnt && v_event_grow(sp, nitems))
                 return (1);
-        if (gp->i_cnt)
-                MEMMOVE(gp->i_event + TERM_PUSH_SHIFT + nitems,
-                    gp->i_event + gp->i_next, gp->i_cnt);
-        gp->i_next = TERM_PUSH_SHIFT;
+
+        /* Back up the front of the queue, wrapping as necessary. */
+        if (gp->i_cnt != 0)
+                gp->i_next = gp->i_next >= nitems ?
+                    gp->i_next - nitems : gp->i_next + gp->i_nelem - nitems;
+        gp->i_cnt += nitems;
 
         /* Put the new items into the queue. */
-copy:   gp->i_cnt += nitems;
-        for (evp = gp->i_event + gp->i_next; nitems--; ++evp) {
+        for (off = gp->i_next; nitems--;) {
+                evp = gp->i_event + off;
                 if (p_evp != NULL)
                         *evp = *p_evp++;
                 else {
-                        if (evp == NULL)
-                            return (1);
                         evp->e_event = E_CHARACTER;
                         evp->e_c = *p_s++;
                         evp->e_value = KEY_VAL(sp, evp->e_c);
                         F_INIT(&evp->e_ch, flags);
                 }
+                if (++off == gp->i_nelem)
+                        off = 0;
         }
         return (0);
 }
@@ -380,28 +376,29 @@ v_event_append(SCR *sp, EVENT *argp)
         EVENT *evp;
         GS *gp;
         size_t nevents;                 /* Number of events. */
+        size_t off;
 
         /* Grow the buffer as necessary. */
         nevents = argp->e_event == E_STRING ? argp->e_len : 1;
         gp = sp->gp;
-        if (gp->i_event == NULL ||
-            nevents > gp->i_nelem - (gp->i_next + gp->i_cnt))
-                v_event_grow(sp, MAXIMUM(nevents, 64));
-        evp = gp->i_event + gp->i_next + gp->i_cnt;
+        if (nevents > gp->i_nelem - gp->i_cnt && v_event_grow(sp, nevents))
+                return (1);
+        off = QOFF(gp, gp->i_cnt);
         gp->i_cnt += nevents;
 
         /* Transform strings of characters into single events. */
-        if (argp == NULL || evp == NULL)
-                return (1);
         if (argp->e_event == E_STRING)
-                for (s = argp->e_csp; nevents--; ++evp) {
+                for (s = argp->e_csp; nevents--;) {
+                        evp = gp->i_event + off;
                         evp->e_event = E_CHARACTER;
                         evp->e_c = *s++;
                         evp->e_value = KEY_VAL(sp, evp->e_c);
                         evp->e_flags = 0;
+                        if (++off == gp->i_nelem)
+                                off = 0;
                 }
         else
-                *evp = *argp;
+                gp->i_event[off] = *argp;
         return (0);
 }
 
@@ -410,7 +407,7 @@ v_event_append(SCR *sp, EVENT *argp)
         if ((gp->i_cnt -= (len)) == 0)                                  \
                 gp->i_next = 0;                                         \
         else                                                            \
-                gp->i_next += (len);                                    \
+                gp->i_next = QOFF(gp, len);                             \
 }
 
 /*
@@ -506,7 +503,10 @@ v_event_get(SCR *sp, EVENT *argp, int timeout, u_int32_t flags)
         EVENT *evp, ev;
         GS *gp;
         SEQ *qp;
+        size_t blen, i, ilen;
+        seq_t stype;
         int init_nomap, ispartial, istimeout, remap_cnt;
+        char *bp;
 
         gp = sp->gp;
 
@@ -579,6 +579,21 @@ append:                 if (v_event_append(sp, argp))
 
 newmap: evp = &gp->i_event[gp->i_next];
 
+        /*
+         * If the next event is a paste and the caller doesn't take pastes,
+         * replace it with its characters, they're handled like any others.
+         */
+        if (evp->e_event == E_PASTE && !LF_ISSET(EC_PASTE)) {
+                ev = *evp;
+                QREM(1);
+                if (v_event_push(sp, NULL, ev.e_csp, ev.e_len, 0)) {
+                        free(ev.e_asp);
+                        return (1);
+                }
+                free(ev.e_asp);
+                goto newmap;
+        }
+
         /*
          * If the next event in the queue isn't a character event, return
          * it, we're done.
@@ -604,9 +619,23 @@ newmap: evp = &gp->i_event[gp->i_next];
             (evp->e_c < MAX_BIT_SEQ && !bit_test(gp->seqb, evp->e_c)))
                 goto nomap;
 
-        /* Search the map. */
-        qp = seq_find(sp, NULL, evp, NULL, gp->i_cnt,
-            LF_ISSET(EC_MAPCOMMAND) ? SEQ_COMMAND : SEQ_INPUT, &ispartial);
+        /*
+         * Search the map.  No sequence is longer than seqmax keys, so the
+         * search doesn't need more than that.  If those keys wrap around
+         * the end of the queue, copy them so they're contiguous.
+         */
+        ilen = MINIMUM(gp->i_cnt, gp->seqmax);
+        stype = LF_ISSET(EC_MAPCOMMAND) ? SEQ_COMMAND : SEQ_INPUT;
+        if (gp->i_next + ilen <= gp->i_nelem)
+                qp = seq_find(sp, NULL, evp, NULL, ilen, stype, &ispartial);
+        else {
+                GET_SPACE_RET(sp, bp, blen, ilen);
+                for (i = 0; i < ilen; ++i)
+                        bp[i] = gp->i_event[QOFF(gp, i)].e_c;
+                qp = seq_find(sp,
+                    NULL, NULL, (CHAR_T *)bp, ilen, stype, &ispartial);
+                FREE_SPACE(sp, bp, blen);
+        }
 
         /*
          * If get a partial match, get more characters and retry the map.
@@ -656,7 +685,9 @@ not_digit:      argp->e_c = CH_NOT_DIGIT;
         }
 
         /* Find out if the initial segments are identical. */
-        init_nomap = !e_memcmp(qp->output, &gp->i_event[gp->i_next], qp->ilen);
+        init_nomap = qp->output != NULL && qp->olen >= qp->ilen;
+        for (i = 0; init_nomap && i < qp->ilen; ++i)
+                init_nomap = qp->output[i] == gp->i_event[QOFF(gp, i)].e_c;
 
         /* Delete the mapped characters from the queue. */
         QREM(qp->ilen);
@@ -745,6 +776,9 @@ v_event_err(SCR *sp, EVENT *evp)
         case E_INTERRUPT:
                 msgq(sp, M_ERR, "Unexpected interrupt event");
                 break;
+        case E_PASTE:
+                msgq(sp, M_ERR, "Unexpected paste event");
+                break;
         case E_QUIT:
                 msgq(sp, M_ERR, "Unexpected quit event");
                 break;
@@ -792,26 +826,136 @@ v_event_flush(SCR *sp, u_int flags)
         int rval;
 
         for (rval = 0, gp = sp->gp; gp->i_cnt != 0 &&
+            gp->i_event[gp->i_next].e_event == E_CHARACTER &&
             F_ISSET(&gp->i_event[gp->i_next].e_ch, flags); rval = 1)
                 QREM(1);
         return (rval);
 }
 
+/*
+ * v_timer_set --
+ *      Set a timer to go off in ms milliseconds, resetting it if it's
+ *      already set.
+ *
+ * PUBLIC: void v_timer_set(SCR *, TIMER *, int);
+ */
+void
+v_timer_set(SCR *sp, TIMER *tp, int ms)
+{
+        struct timespec ts;
+        GS *gp;
+        TIMER *ntp, *ptp;
+
+        gp = sp->gp;
+        v_timer_clr(sp, tp);
+
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = (ms % 1000) * 1000000;
+        (void)clock_gettime(CLOCK_MONOTONIC, &tp->when);
+        timespecadd(&tp->when, &ts, &tp->when);
+
+        /* Keep the list sorted by deadline. */
+        for (ptp = NULL, ntp = LIST_FIRST(&gp->timerq);
+            ntp != NULL && !timespeccmp(&tp->when, &ntp->when, <);
+            ptp = ntp, ntp = LIST_NEXT(ntp, q));
+        if (ptp == NULL)
+                LIST_INSERT_HEAD(&gp->timerq, tp, q);
+        else
+                LIST_INSERT_AFTER(ptp, tp, q);
+        F_SET(tp, TIMER_SET);
+}
+
+/*
+ * v_timer_clr --
+ *      Cancel a timer.
+ *
+ * PUBLIC: void v_timer_clr(SCR *, TIMER *);
+ */
+void
+v_timer_clr(SCR *sp, TIMER *tp)
+{
+        if (!F_ISSET(tp, TIMER_SET))
+                return;
+        LIST_REMOVE(tp, q);
+        F_CLR(tp, TIMER_SET);
+}
+
+/*
+ * v_timer_next --
+ *      Return the milliseconds until the next timer goes off, 0 if one
+ *      is due, and -1 if there are no timers.
+ *
+ * PUBLIC: int v_timer_next(GS *);
+ */
+int
+v_timer_next(GS *gp)
+{
+        struct timespec now, ts;
+        TIMER *tp;
+
+        if ((tp = LIST_FIRST(&gp->timerq)) == NULL)
+                return (-1);
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        if (!timespeccmp(&now, &tp->when, <))
+                return (0);
+        timespecsub(&tp->when, &now, &ts);
+
+        /* Round up, so the timer is due when we come back. */
+        if (ts.tv_sec > INT_MAX / 1000 - 1)
+                return (INT_MAX);
+        return (ts.tv_sec * 1000 + (ts.tv_nsec + 999999) / 1000000);
+}
+
+/*
+ * v_timer_run --
+ *      Call the functions of any timers that are due.
+ *
+ * PUBLIC: void v_timer_run(SCR *);
+ */
+void
+v_timer_run(SCR *sp)
+{
+        GS *gp;
+        TIMER *tp;
+
+        /*
+         * The timer is off when its function is called, so the function
+         * can set it again.
+         */
+        for (gp = sp->gp; (tp = LIST_FIRST(&gp->timerq)) != NULL &&
+            v_timer_next(gp) == 0;) {
+                v_timer_clr(sp, tp);
+                tp->func(sp);
+        }
+}
+
 /*
  * v_event_grow --
- *      Grow the terminal queue.
+ *      Grow the terminal queue to hold at least add more events.
  */
 static int
-v_event_grow(SCR *sp, int add)
+v_event_grow(SCR *sp, size_t add)
 {
         GS *gp;
-        size_t new_nelem, olen;
+        size_t n, new_nelem, olen, onelem;
 
         gp = sp->gp;
-        new_nelem = gp->i_nelem + add;
-        olen = gp->i_nelem * sizeof(gp->i_event[0]);
+        onelem = gp->i_nelem;
+        new_nelem = MAXIMUM(onelem * 2, MAXIMUM(gp->i_cnt + add, 64));
+        olen = onelem * sizeof(gp->i_event[0]);
         BINC_RET(sp, gp->i_event, olen, new_nelem * sizeof(gp->i_event[0]));
         gp->i_nelem = olen / sizeof(gp->i_event[0]);
+
+        /*
+         * If the queue wrapped, move the events at the end of the old
+         * array to the end of the new one.
+         */
+        if (gp->i_next + gp->i_cnt > onelem) {
+                n = onelem - gp->i_next;
+                MEMMOVE(gp->i_event + gp->i_nelem - n,
+                    gp->i_event + gp->i_next, n);
+                gp->i_next = gp->i_nelem - n;
+        }
         return (0);
 }
 
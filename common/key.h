@@ -40,6 +40,7 @@ typedef enum {
         E_EOF,                          /* End of input (NOT ^D). */
         E_ERR,                          /* Input error. */
         E_INTERRUPT,                    /* Interrupt. */
+        E_PASTE,                        /* Paste: e_asp, e_csp, e_len set. */
         E_QUIT,                         /* Quit. */
         E_REPAINT,                      /* Repaint: e_flno, e_tlno set. */
         E_SIGHUP,                       /* SIGHUP. */
@@ -89,6 +90,7 @@ struct _event {
 #define CH_MAPPED       0x02            /* Character is from a map. */
 #define CH_NOMAP        0x04            /* Do not map the character. */
 #define CH_QUOTED       0x08            /* Character is already quoted. */
+#define CH_PASTE        0x10            /* Character is from a paste. */
                         u_int8_t flags;
                 } _e_ch;
 #define e_ch    _u_event._e_ch          /* !!! The structure, not the char. */
@@ -120,6 +122,21 @@ struct _event {
         } _u_event;
 };
 
+/*
+ * Timers.  A timer's function is called once, by the screen's event loop,
+ * the first time the editor is waiting for input after the deadline.  The
+ * editor's data structures are consistent when that happens, it's the same
+ * place that script window output is inserted into the file.
+ */
+struct _timer {
+        LIST_ENTRY(_timer) q;           /* Linked list of pending timers. */
+        struct timespec when;           /* Deadline. */
+        void    (*func)(SCR *);         /* Function to call. */
+
+#define TIMER_SET       0x01            /* Timer is pending. */
+        u_int8_t flags;
+};
+
 typedef struct _keylist {
         e_key_t value;                  /* Special value. */
         CHAR_T ch;                      /* Key. */
@@ -130,6 +147,7 @@ extern KEYLIST keylist[];
 #define KEYS_WAITING(sp)        ((sp)->gp->i_cnt != 0)
 #define MAPPED_KEYS_WAITING(sp)                                            \
         (KEYS_WAITING(sp) &&                                               \
+            (sp)->gp->i_event[(sp)->gp->i_next].e_event == E_CHARACTER &&  \
             F_ISSET(&(sp)->gp->i_event[(sp)->gp->i_next].e_ch, CH_MAPPED))
 
 /* The "standard" tab width, for displaying things to users. */
@@ -174,6 +192,7 @@ extern KEYLIST keylist[];
 #define EC_QUOTED       0x010           /* Try to quote next character */
 #define EC_RAW          0x020           /* Any next character. XXX: not used. */
 #define EC_TIMEOUT      0x040           /* Timeout to next character. */
+#define EC_PASTE        0x080           /* Return pastes as single events. */
 
 /* Flags describing text input special cases. */
 #define TXT_ADDNEWLINE  0x00000001      /* Replay starts on a new line. */
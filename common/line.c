@@ -179,9 +179,9 @@ db_delete(SCR *sp, recno_t lno)
         }
 
         /* Update marks, @ and global commands. */
-        if (mark_insdel(sp, LINE_DELETE, lno))
+        if (mark_insdel(sp, LINE_DELETE, lno, 1))
                 return (1);
-        if (ex_g_insdel(sp, LINE_DELETE, lno))
+        if (ex_g_insdel(sp, LINE_DELETE, lno, 1))
                 return (1);
 
         /* Log change. */
@@ -206,6 +206,8 @@ db_delete(SCR *sp, recno_t lno)
         if (F_ISSET(ep, F_FIRSTMODIFY))
                 (void)rcv_init(sp);
         F_SET(ep, F_MODIFIED | F_RCV_SYNC);
+        if (ep->rcv_jnl != NULL)
+                rcv_jnl(sp, LINE_DELETE, lno, NULL, 0);
 
         /* Update screen. */
         return (scr_update(sp, lno, LINE_DELETE, 1));
@@ -251,15 +253,17 @@ db_append(SCR *sp, int update, recno_t lno, char *p, size_t len)
         if (F_ISSET(ep, F_FIRSTMODIFY))
                 (void)rcv_init(sp);
         F_SET(ep, F_MODIFIED | F_RCV_SYNC);
+        if (ep->rcv_jnl != NULL)
+                rcv_jnl(sp, LINE_APPEND, lno, p, len);
 
         /* Log change. */
         log_line(sp, lno + 1, LOG_LINE_APPEND);
 
         /* Update marks, @ and global commands. */
         rval = 0;
-        if (mark_insdel(sp, LINE_INSERT, lno + 1))
+        if (mark_insdel(sp, LINE_INSERT, lno + 1, 1))
                 rval = 1;
-        if (ex_g_insdel(sp, LINE_INSERT, lno + 1))
+        if (ex_g_insdel(sp, LINE_INSERT, lno + 1, 1))
                 rval = 1;
 
         /*
@@ -275,6 +279,84 @@ db_append(SCR *sp, int update, recno_t lno, char *p, size_t len)
         return (scr_update(sp, lno, LINE_APPEND, update) || rval);
 }
 
+/*
+ * db_appendv --
+ *      Append a set of lines into the file.  The lines are logged in as
+ *      few records as possible, and the marks and @ and global commands
+ *      are updated once, not once per line.
+ *
+ * PUBLIC: int db_appendv(SCR *, int, recno_t, CBLINE *, recno_t);
+ */
+int
+db_appendv(SCR *sp, int update, recno_t lno, CBLINE *lp, recno_t cnt)
+{
+        DBT data, key;
+        EXF *ep;
+        recno_t n, tlno;
+        int empty, rval;
+
+        /* Check for no underlying file. */
+        if ((ep = sp->ep) == NULL) {
+                ex_emsg(sp, NULL, EXM_NOFILEYET);
+                return (1);
+        }
+
+        /* See vs_change: the first line of an empty file is a reset. */
+        empty = lno == 0 && !db_exist(sp, 1);
+
+        /* Update file, stopping at the first failure. */
+        rval = 0;
+        for (n = 0; n < cnt; ++n) {
+                tlno = lno + n;
+                key.data = &tlno;
+                key.size = sizeof(tlno);
+                data.data = lp[n].lb;
+                data.size = lp[n].len;
+                if (ep->db->put(ep->db, &key, &data, R_IAFTER) == -1) {
+                        msgq(sp, M_SYSERR,
+                            "unable to append to line %'lu", (u_long)tlno);
+                        rval = 1;
+                        break;
+                }
+        }
+        if ((cnt = n) == 0)
+                return (rval);
+
+        /* Flush the cache, update line count, before screen update. */
+        if (lno < ep->c_lno)
+                ep->c_lno = OOBLNO;
+        if (ep->c_nlines != OOBLNO)
+                ep->c_nlines += cnt;
+
+        /* File now dirty. */
+        if (F_ISSET(ep, F_FIRSTMODIFY))
+                (void)rcv_init(sp);
+        F_SET(ep, F_MODIFIED | F_RCV_SYNC);
+        if (ep->rcv_jnl != NULL)
+                for (n = 0; n < cnt; ++n)
+                        rcv_jnl(sp, LINE_APPEND, lno + n, lp[n].lb, lp[n].len);
+
+        /* Log change. */
+        log_lines(sp, lno + 1, lp, cnt);
+
+        /* Update marks, @ and global commands. */
+        if (mark_insdel(sp, LINE_INSERT, lno + 1, cnt))
+                rval = 1;
+        if (ex_g_insdel(sp, LINE_INSERT, lno + 1, cnt))
+                rval = 1;
+
+        /*
+         * Update screen.  Lines appended after the bottom of the screen
+         * are ignored, so this stops costing anything once the screen
+         * has been filled.
+         */
+        for (n = 0; n < cnt; ++n)
+                if (n == 0 && empty ? scr_update(sp, 1, LINE_RESET, update) :
+                    scr_update(sp, lno + n, LINE_APPEND, update))
+                        return (1);
+        return (rval);
+}
+
 /*
  * db_insert --
  *      Insert a line into the file.
@@ -315,15 +397,17 @@ db_insert(SCR *sp, recno_t lno, char *p, size_t len)
         if (F_ISSET(ep, F_FIRSTMODIFY))
                 (void)rcv_init(sp);
         F_SET(ep, F_MODIFIED | F_RCV_SYNC);
+        if (ep->rcv_jnl != NULL)
+                rcv_jnl(sp, LINE_INSERT, lno, p, len);
 
         /* Log change. */
         log_line(sp, lno, LOG_LINE_INSERT);
 
         /* Update marks, @ and global commands. */
         rval = 0;
-        if (mark_insdel(sp, LINE_INSERT, lno))
+        if (mark_insdel(sp, LINE_INSERT, lno, 1))
                 rval = 1;
-        if (ex_g_insdel(sp, LINE_INSERT, lno))
+        if (ex_g_insdel(sp, LINE_INSERT, lno, 1))
                 rval = 1;
 
         /* Update screen. */
@@ -370,6 +454,8 @@ db_set(SCR *sp, recno_t lno, char *p, size_t len)
         if (F_ISSET(ep, F_FIRSTMODIFY))
                 (void)rcv_init(sp);
         F_SET(ep, F_MODIFIED | F_RCV_SYNC);
+        if (ep->rcv_jnl != NULL)
+                rcv_jnl(sp, LINE_RESET, lno, p, len);
 
         /* Log after change. */
         log_line(sp, lno, LOG_LINE_RESET_F);
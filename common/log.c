@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <bsd_stdlib.h>
 #include <bsd_string.h>
+#include <bsd_unistd.h>
 
 #include <bsd_db.h>
 
@@ -41,34 +42,111 @@
  *      LOG_LINE_APPEND         recno_t         char *
  *      LOG_LINE_DELETE         recno_t         char *
  *      LOG_LINE_INSERT         recno_t         char *
- *      LOG_LINE_RESET_F        recno_t         char *
- *      LOG_LINE_RESET_B        recno_t         char *
  *      LOG_MARK                LMARK
+ *      LOG_LINE_DELTA          recno_t         size_t size_t size_t
+ *                                              char * char *
+ *      LOG_LINE_APPENDV        recno_t recno_t [size_t char *] ...
  *
- * We do before image physical logging.  This means that the editor layer
- * MAY NOT modify records in place, even if simply deleting or overwriting
- * characters.  Since the smallest unit of logging is a line, we're using
- * up lots of space.  This may eventually have to be reduced, probably by
- * doing logical logging, which is a much cooler database phrase.
+ * We do before image physical logging of appended, deleted and inserted
+ * lines.  Changed lines are logged logically, as deltas: log_line() is
+ * called with LOG_LINE_RESET_B before a line is changed, and copies the
+ * line, and with LOG_LINE_RESET_F after the change, and puts out a
+ * LOG_LINE_DELTA record of the offset of the first byte that differs,
+ * the lengths of the replaced and replacing bytes, and the bytes.  So,
+ * changing one character of a long line logs a few bytes, not two copies
+ * of the line.  The editor layer still MAY NOT modify records in place,
+ * even if simply deleting or overwriting characters, because the before
+ * image is read from the file.  A run of lines appended at once, e.g., by
+ * a put, is logged by log_lines() as LOG_LINE_APPENDV records, each holding
+ * the first line number, a count and up to LOG_CHUNKSZ bytes of lines.
  *
  * The implementation of the historic vi 'u' command, using roll-forward and
  * roll-back, is simple.  Each set of changes has a LOG_CURSOR_INIT record,
  * followed by a number of other records, followed by a LOG_CURSOR_END record.
- * LOG_LINE_RESET records come in pairs.  The first is a LOG_LINE_RESET_B
- * record, and is the line before the change.  The second is LOG_LINE_RESET_F,
- * and is the line after the change.  Roll-back is done by backing up to the
- * first LOG_CURSOR_INIT record before a change.  Roll-forward is done in a
- * similar fashion.
+ * LOG_LINE_DELTA records are applied to the line as it is: rolling back
+ * replaces the new bytes with the old ones, rolling forward does the
+ * reverse.  Roll-back is done by backing up to the first LOG_CURSOR_INIT
+ * record before a change.  Roll-forward is done in a similar fashion.
  *
  * The 'U' command is implemented by rolling backward to a LOG_CURSOR_END
  * record for a line different from the current one.  It should be noted that
  * this means that a subsequent 'u' command will make a change based on the
  * new position of the log's cursor.  This is okay, and, in fact, historic vi
- * behaved that way.
+ * behaved that way.  Each set of changes is also indexed, by its first record
+ * and the range of lines its LOG_LINE_DELTA records change, so 'U' can step
+ * over sets of changes that didn't change the line without reading them.
+ *
+ * The records are kept in memory, in an append-only arena of LOG_CHUNKSZ
+ * chunks, with an array indexing the records by number.  Putting out a
+ * record at the log's cursor discards any records after it, i.e. the ones
+ * that could have been rolled forward, so the arena is simply truncated at
+ * that point.  Once the arena holds more than LOG_MEMMAX bytes, the oldest
+ * chunks are written to an unlinked temporary file and read back a record
+ * at a time as the log is rolled back over them.
+ *
+ * If the undolimit option is set, the log is bounded: when a set of changes
+ * starts and the log holds more than undolimit kilobytes of records, the
+ * oldest sets of changes are discarded until it's back under three quarters
+ * of the limit.  The most recent complete set of changes is always kept, so
+ * the last change can always be undone.
  */
+#define LOG_CHUNKSZ     (64 * 1024)             /* Arena chunk size. */
+#define LOG_MEMMAX      (8 * 1024 * 1024)       /* Arena memory budget. */
+
+typedef struct {
+        char    *mem;                   /* Chunk, or NULL if spilled. */
+        off_t    foff;                  /* Spill file offset. */
+        size_t   size;                  /* Chunk size. */
+        size_t   used;                  /* Chunk bytes in use. */
+} LOG_CHUNK;
+
+typedef struct {
+        size_t   chunk;                 /* Chunk index. */
+        size_t   off;                   /* Chunk offset. */
+        size_t   len;                   /* Record length. */
+        u_char   type;                  /* Record type. */
+} LOG_REC;
+
+typedef struct {
+        recno_t  start;                 /* LOG_CURSOR_INIT record. */
+        recno_t  lmin, lmax;            /* Lines changed. */
+        int      marks;                 /* If marks were logged. */
+} LOG_GROUP;
+
+struct _log_arena {
+        LOG_CHUNK *chunks;              /* Chunks. */
+        size_t   nchunks, mchunks;
+        size_t   nspill;                /* Leading chunks spilled. */
+        size_t   mem;                   /* Chunk bytes in memory. */
+
+        LOG_REC *recs;                  /* Records, 1-N is 0 to N-1. */
+        size_t   nrecs, mrecs;
+        size_t   bytes;                 /* Record bytes. */
+
+        LOG_GROUP *groups;              /* Sets of changes. */
+        size_t   ngroups, mgroups;
+
+        int      fd;                    /* Spill file, or -1. */
+        off_t    fsize;                 /* Spill file size. */
+        off_t   *fslot;                 /* Free LOG_CHUNKSZ file slots. */
+        size_t   nfslot, mfslot;
+        char    *rbuf;                  /* Spilled record buffer. */
+        size_t   rlen;                  /* Spilled record buffer length. */
+};
 
 static int      log_cursor1(SCR *, int);
+static int      log_delta(SCR *, recno_t, char *, size_t);
+static int      log_dset(SCR *, u_char *, int, recno_t *);
+static int      log_vset(SCR *, u_char *, int);
 static void     log_err(SCR *, char *, int);
+static void     log_free(LOG_ARENA *);
+static void     log_funspill(LOG_ARENA *);
+static int      log_get(SCR *, recno_t, u_char **, size_t *);
+static LOG_GROUP *log_group(LOG_ARENA *, recno_t);
+static int      log_put(SCR *, size_t);
+static void     log_release(LOG_ARENA *, LOG_CHUNK *);
+static void     log_spill(LOG_ARENA *);
+static void     log_trim(SCR *);
 
 /* Try and restart the log on failure, i.e. if we run out of memory. */
 #define LOG_ERR {                                                       \
@@ -99,13 +177,12 @@ log_init(SCR *sp, EXF *ep)
         ep->l_cursor.cno = 0;
         ep->l_high = ep->l_cur = 1;
 
-        ep->log = dbopen(NULL, O_CREAT | O_NONBLOCK | O_RDWR,
-            S_IRUSR | S_IWUSR, DB_RECNO, NULL);
-        if (ep->log == NULL) {
+        if ((ep->log = calloc(1, sizeof(LOG_ARENA))) == NULL) {
                 msgq(sp, M_SYSERR, "Log file");
                 F_SET(ep, F_NOLOG);
                 return (1);
         }
+        ep->log->fd = -1;
 
         return (0);
 }
@@ -124,12 +201,15 @@ log_end(SCR *sp, EXF *ep)
          * ep MAY NOT BE THE SAME AS sp->ep, DON'T USE THE LATTER.
          */
         if (ep->log != NULL) {
-                (void)(ep->log->close)(ep->log);
+                log_free(ep->log);
                 ep->log = NULL;
         }
         free(ep->l_lp);
         ep->l_lp = NULL;
         ep->l_len = 0;
+        free(ep->l_bp);
+        ep->l_bp = NULL;
+        ep->l_blen = 0;
         ep->l_cursor.lno = 1;           /* XXX Any valid recno. */
         ep->l_cursor.cno = 0;
         ep->l_high = ep->l_cur = 1;
@@ -172,7 +252,6 @@ log_cursor(SCR *sp)
 static int
 log_cursor1(SCR *sp, int type)
 {
-        DBT data, key;
         EXF *ep;
 
         ep = sp->ep;
@@ -180,16 +259,16 @@ log_cursor1(SCR *sp, int type)
         ep->l_lp[0] = type;
         memmove(ep->l_lp + sizeof(u_char), &ep->l_cursor, sizeof(MARK));
 
-        key.data = &ep->l_cur;
-        key.size = sizeof(recno_t);
-        data.data = ep->l_lp;
-        data.size = sizeof(u_char) + sizeof(MARK);
-        if (ep->log->put(ep->log, &key, &data, 0) == -1)
+        if (log_put(sp, sizeof(u_char) + sizeof(MARK)))
                 LOG_ERR;
 
         /* Reset high water mark. */
         ep->l_high = ++ep->l_cur;
 
+        /* A set of changes is starting, keep the log within its budget. */
+        if (type == LOG_CURSOR_INIT)
+                log_trim(sp);
+
         return (0);
 }
 
@@ -202,7 +281,6 @@ log_cursor1(SCR *sp, int type)
 int
 log_line(SCR *sp, recno_t lno, u_int action)
 {
-        DBT data, key;
         EXF *ep;
         size_t len;
         char *lp;
@@ -228,9 +306,10 @@ log_line(SCR *sp, recno_t lno, u_int action)
 
         /*
          * Put out the changes.  If it's a LOG_LINE_RESET_B call, it's a
-         * special case, avoid the caches.  Also, if it fails and it's
-         * line 1, it just means that the user started with an empty file,
-         * so fake an empty length line.
+         * special case, avoid the caches, and save the line until the
+         * LOG_LINE_RESET_F call.  Also, if it fails and it's line 1, it
+         * just means that the user started with an empty file, so fake
+         * an empty length line.
          */
         if (action == LOG_LINE_RESET_B) {
                 if (db_get(sp, lno, DBG_NOCACHE, &lp, &len)) {
@@ -241,20 +320,139 @@ log_line(SCR *sp, recno_t lno, u_int action)
                         len = 0;
                         lp = "";
                 }
-        } else
-                if (db_get(sp, lno, DBG_FATAL, &lp, &len))
-                        return (1);
+                BINC_RET(sp, ep->l_bp, ep->l_blen, len);
+                if (len != 0)
+                        memmove(ep->l_bp, lp, len);
+                ep->l_bsize = len;
+                ep->l_blno = lno;
+                return (0);
+        }
+        if (db_get(sp, lno, DBG_FATAL, &lp, &len))
+                return (1);
+        if (action == LOG_LINE_RESET_F)
+                return (log_delta(sp, lno, lp, len));
         BINC_RET(sp,
             ep->l_lp, ep->l_len, len + sizeof(u_char) + sizeof(recno_t));
         ep->l_lp[0] = action;
         memmove(ep->l_lp + sizeof(u_char), &lno, sizeof(recno_t));
         memmove(ep->l_lp + sizeof(u_char) + sizeof(recno_t), lp, len);
 
-        key.data = &ep->l_cur;
-        key.size = sizeof(recno_t);
-        data.data = ep->l_lp;
-        data.size = len + sizeof(u_char) + sizeof(recno_t);
-        if (ep->log->put(ep->log, &key, &data, 0) == -1)
+        if (log_put(sp, len + sizeof(u_char) + sizeof(recno_t)))
+                LOG_ERR;
+
+        /* Reset high water mark. */
+        ep->l_high = ++ep->l_cur;
+
+        return (0);
+}
+
+/*
+ * log_lines --
+ *      Log a run of appended lines.
+ *
+ * PUBLIC: int log_lines(SCR *, recno_t, CBLINE *, recno_t);
+ */
+int
+log_lines(SCR *sp, recno_t lno, CBLINE *lp, recno_t cnt)
+{
+        EXF *ep;
+        recno_t n;
+        size_t hlen, len;
+        char *p;
+
+        ep = sp->ep;
+        if (F_ISSET(ep, F_NOLOG))
+                return (0);
+
+        /* As in log_line, the next 'u' command does a roll-back. */
+        F_CLR(ep, F_UNDO);
+
+        /* Put out one initial cursor record per set of changes. */
+        if (ep->l_cursor.lno != OOBLNO) {
+                if (log_cursor1(sp, LOG_CURSOR_INIT))
+                        return (1);
+                ep->l_cursor.lno = OOBLNO;
+        }
+
+        hlen = sizeof(u_char) + 2 * sizeof(recno_t);
+        while (cnt > 0) {
+                /* Take at least one line, and as many as fit in a chunk. */
+                len = hlen;
+                for (n = 0; n < cnt && (n == 0 ||
+                    len + sizeof(size_t) + lp[n].len <= LOG_CHUNKSZ); ++n)
+                        len += sizeof(size_t) + lp[n].len;
+
+                BINC_RET(sp, ep->l_lp, ep->l_len, len);
+                ep->l_lp[0] = LOG_LINE_APPENDV;
+                memmove(ep->l_lp + sizeof(u_char), &lno, sizeof(recno_t));
+                memmove(ep->l_lp + sizeof(u_char) + sizeof(recno_t),
+                    &n, sizeof(recno_t));
+                for (p = ep->l_lp + hlen,
+                    lno += n, cnt -= n; n > 0; --n, ++lp) {
+                        memmove(p, &lp->len, sizeof(size_t));
+                        p += sizeof(size_t);
+                        memmove(p, lp->lb, lp->len);
+                        p += lp->len;
+                }
+
+                if (log_put(sp, len))
+                        LOG_ERR;
+
+                /* Reset high water mark. */
+                ep->l_high = ++ep->l_cur;
+        }
+        return (0);
+}
+
+/*
+ * log_delta --
+ *      Log the difference between a line and its saved before image.
+ */
+static int
+log_delta(SCR *sp, recno_t lno, char *lp, size_t len)
+{
+        EXF *ep;
+        size_t hlen, nlen, off, olen;
+        char *bp, *p;
+
+        /*
+         * If saving the before image failed, there's nothing to compare
+         * the line to, and the change can't be undone.
+         */
+        ep = sp->ep;
+        if (ep->l_blno != lno)
+                LOG_ERR;
+        ep->l_blno = OOBLNO;
+
+        /* Trim the bytes the two images have in common. */
+        bp = ep->l_bp;
+        olen = ep->l_bsize;
+        nlen = len;
+        for (off = 0; off < olen && off < nlen && bp[off] == lp[off]; ++off)
+                continue;
+        olen -= off;
+        nlen -= off;
+        for (; olen > 0 && nlen > 0 &&
+            bp[off + olen - 1] == lp[off + nlen - 1]; --olen, --nlen)
+                continue;
+
+        hlen = sizeof(u_char) + sizeof(recno_t) + 3 * sizeof(size_t);
+        BINC_RET(sp, ep->l_lp, ep->l_len, hlen + olen + nlen);
+        p = ep->l_lp;
+        p[0] = LOG_LINE_DELTA;
+        p += sizeof(u_char);
+        memmove(p, &lno, sizeof(recno_t));
+        p += sizeof(recno_t);
+        memmove(p, &off, sizeof(size_t));
+        p += sizeof(size_t);
+        memmove(p, &olen, sizeof(size_t));
+        p += sizeof(size_t);
+        memmove(p, &nlen, sizeof(size_t));
+        p += sizeof(size_t);
+        memmove(p, bp + off, olen);
+        memmove(p + olen, lp + off, nlen);
+
+        if (log_put(sp, hlen + olen + nlen))
                 LOG_ERR;
 
         /* Reset high water mark. */
@@ -263,6 +461,95 @@ log_line(SCR *sp, recno_t lno, u_int action)
         return (0);
 }
 
+/*
+ * log_dset --
+ *      Apply a LOG_LINE_DELTA record to its line, rolling it backward
+ *      or forward.
+ */
+static int
+log_dset(SCR *sp, u_char *p, int forward, recno_t *lnop)
+{
+        EXF *ep;
+        recno_t lno;
+        size_t dlen, ilen, len, nlen, off, olen;
+        char *ip, *lp;
+
+        ep = sp->ep;
+        p += sizeof(u_char);
+        memmove(&lno, p, sizeof(recno_t));
+        p += sizeof(recno_t);
+        memmove(&off, p, sizeof(size_t));
+        p += sizeof(size_t);
+        memmove(&olen, p, sizeof(size_t));
+        p += sizeof(size_t);
+        memmove(&nlen, p, sizeof(size_t));
+        p += sizeof(size_t);
+        *lnop = lno;
+
+        /* Replace the new bytes with the old ones, or vice versa. */
+        if (forward) {
+                ip = (char *)p + olen;
+                ilen = nlen;
+                dlen = olen;
+        } else {
+                ip = (char *)p;
+                ilen = olen;
+                dlen = nlen;
+        }
+
+        /* As in log_line, line 1 of an empty file doesn't exist. */
+        if (db_get(sp, lno, 0, &lp, &len)) {
+                if (lno != 1) {
+                        db_err(sp, lno);
+                        return (1);
+                }
+                len = 0;
+                lp = "";
+        }
+        /* A record that doesn't fit the line can't be applied. */
+        if (off + dlen > len)
+                LOG_ERR;
+
+        BINC_RET(sp, ep->l_lp, ep->l_len, len - dlen + ilen);
+        memmove(ep->l_lp, lp, off);
+        memmove(ep->l_lp + off, ip, ilen);
+        memmove(ep->l_lp + off + ilen, lp + off + dlen, len - off - dlen);
+        return (db_set(sp, lno, ep->l_lp, len - dlen + ilen));
+}
+
+/*
+ * log_vset --
+ *      Apply a LOG_LINE_APPENDV record, deleting its lines to roll it
+ *      backward, or inserting them to roll it forward.
+ */
+static int
+log_vset(SCR *sp, u_char *p, int forward)
+{
+        recno_t cnt, lno;
+        size_t len;
+
+        p += sizeof(u_char);
+        memmove(&lno, p, sizeof(recno_t));
+        p += sizeof(recno_t);
+        memmove(&cnt, p, sizeof(recno_t));
+        p += sizeof(recno_t);
+
+        for (; cnt > 0; --cnt)
+                if (forward) {
+                        memmove(&len, p, sizeof(size_t));
+                        p += sizeof(size_t);
+                        if (db_insert(sp, lno++, (char *)p, len))
+                                return (1);
+                        p += len;
+                        ++sp->rptlines[L_ADDED];
+                } else {
+                        if (db_delete(sp, lno))
+                                return (1);
+                        ++sp->rptlines[L_DELETED];
+                }
+        return (0);
+}
+
 /*
  * log_mark --
  *      Log a mark position.  For the log to work, we assume that there
@@ -275,7 +562,6 @@ log_line(SCR *sp, recno_t lno, u_int action)
 int
 log_mark(SCR *sp, LMARK *lmp)
 {
-        DBT data, key;
         EXF *ep;
 
         ep = sp->ep;
@@ -294,11 +580,7 @@ log_mark(SCR *sp, LMARK *lmp)
         ep->l_lp[0] = LOG_MARK;
         memmove(ep->l_lp + sizeof(u_char), lmp, sizeof(LMARK));
 
-        key.data = &ep->l_cur;
-        key.size = sizeof(recno_t);
-        data.data = ep->l_lp;
-        data.size = sizeof(u_char) + sizeof(LMARK);
-        if (ep->log->put(ep->log, &key, &data, 0) == -1)
+        if (log_put(sp, sizeof(u_char) + sizeof(LMARK)))
                 LOG_ERR;
 
         /* Reset high water mark. */
@@ -315,11 +597,11 @@ log_mark(SCR *sp, LMARK *lmp)
 int
 log_backward(SCR *sp, MARK *rp)
 {
-        DBT key, data;
         EXF *ep;
         LMARK lm;
         MARK m;
         recno_t lno;
+        size_t len;
         int didop;
         u_char *p;
 
@@ -337,13 +619,11 @@ log_backward(SCR *sp, MARK *rp)
 
         F_SET(ep, F_NOLOG);             /* Turn off logging. */
 
-        key.data = &ep->l_cur;          /* Initialize db request. */
-        key.size = sizeof(recno_t);
         for (didop = 0;;) {
                 --ep->l_cur;
-                if (ep->log->get(ep->log, &key, &data, 0))
+                if (log_get(sp, ep->l_cur, &p, &len))
                         LOG_ERR;
-                switch (*(p = (u_char *)data.data)) {
+                switch (*p) {
                 case LOG_CURSOR_INIT:
                         if (didop) {
                                 memmove(rp, p + sizeof(u_char), sizeof(MARK));
@@ -365,19 +645,19 @@ log_backward(SCR *sp, MARK *rp)
                         didop = 1;
                         memmove(&lno, p + sizeof(u_char), sizeof(recno_t));
                         if (db_insert(sp, lno, p + sizeof(u_char) +
-                            sizeof(recno_t), data.size - sizeof(u_char) -
+                            sizeof(recno_t), len - sizeof(u_char) -
                             sizeof(recno_t)))
                                 goto err;
                         ++sp->rptlines[L_ADDED];
                         break;
-                case LOG_LINE_RESET_F:
+                case LOG_LINE_APPENDV:
+                        didop = 1;
+                        if (log_vset(sp, p, 0))
+                                goto err;
                         break;
-                case LOG_LINE_RESET_B:
+                case LOG_LINE_DELTA:
                         didop = 1;
-                        memmove(&lno, p + sizeof(u_char), sizeof(recno_t));
-                        if (db_set(sp, lno, p + sizeof(u_char) +
-                            sizeof(recno_t), data.size - sizeof(u_char) -
-                            sizeof(recno_t)))
+                        if (log_dset(sp, p, 0, &lno))
                                 goto err;
                         if (sp->rptlchange != lno) {
                                 sp->rptlchange = lno;
@@ -416,11 +696,12 @@ err:    F_CLR(ep, F_NOLOG);
 int
 log_setline(SCR *sp)
 {
-        DBT key, data;
         EXF *ep;
+        LOG_GROUP *gp;
         LMARK lm;
         MARK m;
         recno_t lno;
+        size_t len;
         u_char *p;
 
         ep = sp->ep;
@@ -435,14 +716,11 @@ log_setline(SCR *sp)
 
         F_SET(ep, F_NOLOG);             /* Turn off logging. */
 
-        key.data = &ep->l_cur;          /* Initialize db request. */
-        key.size = sizeof(recno_t);
-
         for (;;) {
                 --ep->l_cur;
-                if (ep->log->get(ep->log, &key, &data, 0))
+                if (log_get(sp, ep->l_cur, &p, &len))
                         LOG_ERR;
-                switch (*(p = (u_char *)data.data)) {
+                switch (*p) {
                 case LOG_CURSOR_INIT:
                         memmove(&m, p + sizeof(u_char), sizeof(MARK));
                         if (m.lno != sp->lno || ep->l_cur == 1) {
@@ -457,18 +735,23 @@ log_setline(SCR *sp)
                                 F_CLR(ep, F_NOLOG);
                                 return (0);
                         }
+
+                        /* Skip a set of changes that left the line alone. */
+                        gp = log_group(ep->log, ep->l_cur);
+                        if (gp != NULL && !gp->marks &&
+                            (sp->lno < gp->lmin || sp->lno > gp->lmax))
+                                ep->l_cur = gp->start + 1;
                         break;
                 case LOG_LINE_APPEND:
+                case LOG_LINE_APPENDV:
                 case LOG_LINE_INSERT:
                 case LOG_LINE_DELETE:
-                case LOG_LINE_RESET_F:
                         break;
-                case LOG_LINE_RESET_B:
+                case LOG_LINE_DELTA:
                         memmove(&lno, p + sizeof(u_char), sizeof(recno_t));
-                        if (lno == sp->lno &&
-                            db_set(sp, lno, p + sizeof(u_char) +
-                            sizeof(recno_t), data.size - sizeof(u_char) -
-                            sizeof(recno_t)))
+                        if (lno != sp->lno)
+                                break;
+                        if (log_dset(sp, p, 0, &lno))
                                 goto err;
                         if (sp->rptlchange != lno) {
                                 sp->rptlchange = lno;
@@ -500,11 +783,11 @@ err:    F_CLR(ep, F_NOLOG);
 int
 log_forward(SCR *sp, MARK *rp)
 {
-        DBT key, data;
         EXF *ep;
         LMARK lm;
         MARK m;
         recno_t lno;
+        size_t len;
         int didop;
         u_char *p;
 
@@ -522,13 +805,11 @@ log_forward(SCR *sp, MARK *rp)
 
         F_SET(ep, F_NOLOG);             /* Turn off logging. */
 
-        key.data = &ep->l_cur;          /* Initialize db request. */
-        key.size = sizeof(recno_t);
         for (didop = 0;;) {
                 ++ep->l_cur;
-                if (ep->log->get(ep->log, &key, &data, 0))
+                if (log_get(sp, ep->l_cur, &p, &len))
                         LOG_ERR;
-                switch (*(p = (u_char *)data.data)) {
+                switch (*p) {
                 case LOG_CURSOR_END:
                         if (didop) {
                                 ++ep->l_cur;
@@ -544,7 +825,7 @@ log_forward(SCR *sp, MARK *rp)
                         didop = 1;
                         memmove(&lno, p + sizeof(u_char), sizeof(recno_t));
                         if (db_insert(sp, lno, p + sizeof(u_char) +
-                            sizeof(recno_t), data.size - sizeof(u_char) -
+                            sizeof(recno_t), len - sizeof(u_char) -
                             sizeof(recno_t)))
                                 goto err;
                         ++sp->rptlines[L_ADDED];
@@ -556,14 +837,14 @@ log_forward(SCR *sp, MARK *rp)
                                 goto err;
                         ++sp->rptlines[L_DELETED];
                         break;
-                case LOG_LINE_RESET_B:
+                case LOG_LINE_APPENDV:
+                        didop = 1;
+                        if (log_vset(sp, p, 1))
+                                goto err;
                         break;
-                case LOG_LINE_RESET_F:
+                case LOG_LINE_DELTA:
                         didop = 1;
-                        memmove(&lno, p + sizeof(u_char), sizeof(recno_t));
-                        if (db_set(sp, lno, p + sizeof(u_char) +
-                            sizeof(recno_t), data.size - sizeof(u_char) -
-                            sizeof(recno_t)))
+                        if (log_dset(sp, p, 1, &lno))
                                 goto err;
                         if (sp->rptlchange != lno) {
                                 sp->rptlchange = lno;
@@ -598,7 +879,376 @@ log_err(SCR *sp, char *file, int line)
 
         msgq(sp, M_SYSERR, "%s/%d: log put error", basename(file), line);
         ep = sp->ep;
-        (void)ep->log->close(ep->log);
+        log_free(ep->log);
+        free(ep->l_lp);
         if (!log_init(sp, ep))
                 msgq(sp, M_ERR, "Log restarted");
 }
+
+/*
+ * log_put --
+ *      Put out the record in the log buffer at the log's cursor, discarding
+ *      any records after it.
+ */
+static int
+log_put(SCR *sp, size_t len)
+{
+        EXF *ep;
+        LOG_ARENA *lp;
+        LOG_CHUNK *cp;
+        LOG_GROUP *gp;
+        LOG_REC *rp;
+        recno_t lno;
+        size_t nlen;
+        char *p;
+
+        ep = sp->ep;
+        lp = ep->log;
+
+        /* Truncate the arena at the cursor. */
+        if (ep->l_cur <= lp->nrecs) {
+                rp = &lp->recs[ep->l_cur - 1];
+                while (lp->nchunks > rp->chunk + 1)
+                        log_release(lp, &lp->chunks[--lp->nchunks]);
+                cp = &lp->chunks[rp->chunk];
+                if (cp->mem == NULL) {
+                        if ((p = malloc(cp->size)) == NULL)
+                                return (1);
+                        if (pread(lp->fd,
+                            p, rp->off, cp->foff) != (ssize_t)rp->off) {
+                                free(p);
+                                return (1);
+                        }
+                        log_release(lp, cp);
+                        cp->mem = p;
+                        lp->mem += cp->size;
+                        lp->nspill = rp->chunk;
+                        log_funspill(lp);
+                }
+                cp->used = rp->off;
+                for (nlen = ep->l_cur - 1; nlen < lp->nrecs; ++nlen)
+                        lp->bytes -= lp->recs[nlen].len;
+                lp->nrecs = ep->l_cur - 1;
+                while (lp->ngroups != 0 &&
+                    lp->groups[lp->ngroups - 1].start >= ep->l_cur)
+                        --lp->ngroups;
+        }
+
+        /* Find room for the record, starting a new chunk if necessary. */
+        cp = lp->nchunks == 0 ? NULL : &lp->chunks[lp->nchunks - 1];
+        if (cp == NULL || cp->size - cp->used < len) {
+                if (lp->nchunks == lp->mchunks) {
+                        nlen = lp->mchunks == 0 ? 16 : lp->mchunks * 2;
+                        if ((p = reallocarray(lp->chunks,
+                            nlen, sizeof(LOG_CHUNK))) == NULL)
+                                return (1);
+                        lp->chunks = (LOG_CHUNK *)p;
+                        lp->mchunks = nlen;
+                }
+                cp = &lp->chunks[lp->nchunks];
+                cp->size = len > LOG_CHUNKSZ ? len : LOG_CHUNKSZ;
+                if ((cp->mem = malloc(cp->size)) == NULL)
+                        return (1);
+                cp->foff = -1;
+                cp->used = 0;
+                ++lp->nchunks;
+                lp->mem += cp->size;
+        }
+        if (ep->l_lp[0] == LOG_CURSOR_INIT && lp->ngroups == lp->mgroups) {
+                nlen = lp->mgroups == 0 ? 64 : lp->mgroups * 2;
+                if ((p = reallocarray(lp->groups,
+                    nlen, sizeof(LOG_GROUP))) == NULL)
+                        return (1);
+                lp->groups = (LOG_GROUP *)p;
+                lp->mgroups = nlen;
+        }
+        if (lp->nrecs == lp->mrecs) {
+                nlen = lp->mrecs == 0 ? 256 : lp->mrecs * 2;
+                if ((p = reallocarray(lp->recs,
+                    nlen, sizeof(LOG_REC))) == NULL)
+                        return (1);
+                lp->recs = (LOG_REC *)p;
+                lp->mrecs = nlen;
+        }
+
+        memcpy(cp->mem + cp->used, ep->l_lp, len);
+        rp = &lp->recs[lp->nrecs++];
+        rp->chunk = lp->nchunks - 1;
+        rp->off = cp->used;
+        rp->len = len;
+        rp->type = ep->l_lp[0];
+        cp->used += len;
+        lp->bytes += len;
+
+        /* Index the sets of changes. */
+        switch (rp->type) {
+        case LOG_CURSOR_INIT:
+                gp = &lp->groups[lp->ngroups++];
+                gp->start = lp->nrecs;
+                gp->lmin = MAX_REC_NUMBER;
+                gp->lmax = 0;
+                gp->marks = 0;
+                break;
+        case LOG_LINE_DELTA:
+                if (lp->ngroups == 0)
+                        break;
+                gp = &lp->groups[lp->ngroups - 1];
+                memmove(&lno, ep->l_lp + sizeof(u_char), sizeof(recno_t));
+                if (lno < gp->lmin)
+                        gp->lmin = lno;
+                if (lno > gp->lmax)
+                        gp->lmax = lno;
+                break;
+        case LOG_MARK:
+                if (lp->ngroups != 0)
+                        lp->groups[lp->ngroups - 1].marks = 1;
+                break;
+        }
+
+        if (lp->mem > LOG_MEMMAX)
+                log_spill(lp);
+        return (0);
+}
+
+/*
+ * log_get --
+ *      Get a log record.
+ */
+static int
+log_get(SCR *sp, recno_t rno, u_char **pp, size_t *lenp)
+{
+        LOG_ARENA *lp;
+        LOG_CHUNK *cp;
+        LOG_REC *rp;
+
+        lp = sp->ep->log;
+        if (rno < 1 || rno > lp->nrecs)
+                return (1);
+        rp = &lp->recs[rno - 1];
+        cp = &lp->chunks[rp->chunk];
+        *lenp = rp->len;
+        if (cp->mem != NULL) {
+                *pp = (u_char *)cp->mem + rp->off;
+                return (0);
+        }
+        BINC_RET(sp, lp->rbuf, lp->rlen, rp->len);
+        if (pread(lp->fd, lp->rbuf,
+            rp->len, cp->foff + rp->off) != (ssize_t)rp->len)
+                return (1);
+        *pp = (u_char *)lp->rbuf;
+        return (0);
+}
+
+/*
+ * log_group --
+ *      Find the set of changes a log record belongs to.
+ */
+static LOG_GROUP *
+log_group(LOG_ARENA *lp, recno_t rno)
+{
+        size_t base, lim, n;
+
+        /* Binary search for the last set starting at or before rno. */
+        for (base = 0, lim = lp->ngroups; lim != 0; lim >>= 1) {
+                n = base + (lim >> 1);
+                if (lp->groups[n].start <= rno) {
+                        base = n + 1;
+                        --lim;
+                }
+        }
+        return (base == 0 ? NULL : &lp->groups[base - 1]);
+}
+
+/*
+ * log_spill --
+ *      Write the oldest chunks to the spill file, until the arena is within
+ *      its memory budget.  The chunk being filled always stays in memory.
+ *      If there's no spill file, the arena just stays in memory.
+ */
+static void
+log_spill(LOG_ARENA *lp)
+{
+        LOG_CHUNK *cp;
+        off_t foff;
+        char path[] = "/tmp/vi.XXXXXX";
+
+        if (lp->fd == -1) {
+                if ((lp->fd = mkstemp(path)) == -1)
+                        return;
+                (void)unlink(path);
+        }
+        for (; lp->mem > LOG_MEMMAX && lp->nspill + 1 < lp->nchunks;
+            ++lp->nspill) {
+                cp = &lp->chunks[lp->nspill];
+                if (cp->size == LOG_CHUNKSZ && lp->nfslot != 0)
+                        foff = lp->fslot[--lp->nfslot];
+                else {
+                        foff = lp->fsize;
+                        lp->fsize += cp->size;
+                }
+                if (pwrite(lp->fd,
+                    cp->mem, cp->used, foff) != (ssize_t)cp->used) {
+                        if (foff + (off_t)cp->size == lp->fsize)
+                                lp->fsize = foff;
+                        else
+                                lp->fslot[lp->nfslot++] = foff;
+                        return;
+                }
+                cp->foff = foff;
+                free(cp->mem);
+                cp->mem = NULL;
+                lp->mem -= cp->size;
+        }
+}
+
+/*
+ * log_free --
+ *      Free the arena.
+ */
+static void
+log_free(LOG_ARENA *lp)
+{
+        size_t cnt;
+
+        for (cnt = 0; cnt < lp->nchunks; ++cnt)
+                free(lp->chunks[cnt].mem);
+        free(lp->chunks);
+        free(lp->groups);
+        free(lp->recs);
+        free(lp->rbuf);
+        free(lp->fslot);
+        if (lp->fd != -1)
+                (void)close(lp->fd);
+        free(lp);
+}
+
+/*
+ * log_release --
+ *      Release a chunk's memory or spill file slot.
+ */
+static void
+log_release(LOG_ARENA *lp, LOG_CHUNK *cp)
+{
+        size_t nlen;
+        off_t *p;
+
+        if (cp->mem != NULL) {
+                lp->mem -= cp->size;
+                free(cp->mem);
+                cp->mem = NULL;
+        }
+        if (cp->foff == -1)
+                return;
+
+        /* Slots of odd sized chunks are lost until the file is emptied. */
+        if (cp->size == LOG_CHUNKSZ) {
+                if (lp->nfslot == lp->mfslot) {
+                        nlen = lp->mfslot == 0 ? 16 : lp->mfslot * 2;
+                        if ((p = reallocarray(lp->fslot,
+                            nlen, sizeof(off_t))) != NULL) {
+                                lp->fslot = p;
+                                lp->mfslot = nlen;
+                        }
+                }
+                if (lp->nfslot < lp->mfslot)
+                        lp->fslot[lp->nfslot++] = cp->foff;
+        }
+        cp->foff = -1;
+}
+
+/*
+ * log_trim --
+ *      Discard the oldest sets of changes if the log is over its budget.
+ */
+static void
+log_trim(SCR *sp)
+{
+        EXF *ep;
+        LOG_ARENA *lp;
+        size_t c0, cnt, d, dropped, k, keep;
+        u_long limit;
+
+        ep = sp->ep;
+        lp = ep->log;
+        if ((limit = O_VAL(sp, O_UNDOLIMIT)) == 0)
+                return;
+        limit = limit > ULONG_MAX / 1024 ? ULONG_MAX : limit * 1024;
+        if (lp->bytes <= limit)
+                return;
+
+        /*
+         * The last record starts a new set of changes; find the start of
+         * the set before it, which is kept.
+         */
+        for (keep = lp->nrecs - 1; keep > 0;)
+                if (lp->recs[--keep].type == LOG_CURSOR_INIT)
+                        break;
+
+        /* Find the first set of changes to keep. */
+        limit -= limit / 4;
+        for (k = dropped = d = cnt = 0; cnt < keep;) {
+                d += lp->recs[cnt++].len;
+                if (lp->recs[cnt].type == LOG_CURSOR_INIT) {
+                        k = cnt;
+                        dropped = d;
+                        if (lp->bytes - d <= limit)
+                                break;
+                }
+        }
+        if (k == 0)
+                return;
+
+        /* Discard the chunks that hold only discarded records. */
+        c0 = lp->recs[k].chunk;
+        for (cnt = 0; cnt < c0; ++cnt)
+                log_release(lp, &lp->chunks[cnt]);
+        memmove(lp->chunks,
+            lp->chunks + c0, (lp->nchunks - c0) * sizeof(LOG_CHUNK));
+        lp->nchunks -= c0;
+        lp->nspill = lp->nspill > c0 ? lp->nspill - c0 : 0;
+
+        lp->nrecs -= k;
+        memmove(lp->recs, lp->recs + k, lp->nrecs * sizeof(LOG_REC));
+        for (cnt = 0; cnt < lp->nrecs; ++cnt)
+                lp->recs[cnt].chunk -= c0;
+        lp->bytes -= dropped;
+        ep->l_cur -= k;
+        ep->l_high -= k;
+
+        for (cnt = 0; cnt < lp->ngroups && lp->groups[cnt].start <= k; ++cnt)
+                continue;
+        lp->ngroups -= cnt;
+        memmove(lp->groups, lp->groups + cnt, lp->ngroups * sizeof(LOG_GROUP));
+        for (cnt = 0; cnt < lp->ngroups; ++cnt)
+                lp->groups[cnt].start -= k;
+
+        log_funspill(lp);
+}
+
+/*
+ * log_funspill --
+ *      If nothing's spilled any longer, empty the spill file.
+ */
+static void
+log_funspill(LOG_ARENA *lp)
+{
+        if (lp->nspill == 0 && lp->fsize != 0) {
+                lp->fsize = 0;
+                lp->nfslot = 0;
+                (void)ftruncate(lp->fd, 0);
+        }
+}
+
+/*
+ * log_size --
+ *      Return the number of bytes in the log.
+ *
+ * PUBLIC: size_t log_size(SCR *);
+ */
+size_t
+log_size(SCR *sp)
+{
+        if (sp->ep == NULL || sp->ep->log == NULL)
+                return (0);
+        return (sp->ep->log->bytes);
+}
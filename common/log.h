@@ -21,3 +21,5 @@
 #define LOG_LINE_RESET_F        6
 #define LOG_LINE_RESET_B        7
 #define LOG_MARK                8
+#define LOG_LINE_DELTA          9
+#define LOG_LINE_APPENDV        10
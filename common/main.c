@@ -57,16 +57,16 @@ editor(GS *gp, int argc, char *argv[])
         SCR *sp;
         size_t len;
         u_int flags;
-        int ch, flagchk, secure, startup, readonly, rval, silent;
-        char *tag_f, *wsizearg, path[256];
+        int ch, flagchk, jobs, secure, startup, readonly, rval, silent;
+        char *batch_f, *jobs_f, *tag_f, *wsizearg, path[256];
 
         static const char *optstr[3] = {
 #ifdef DEBUG
-                "c:D:FlRrSsT:t:vw:",
+                "b:c:D:Fj:lRrSsT:t:vw:",
                 "c:D:eFlRrST:t:w:",
                 "c:D:eFlrST:t:w:"
 #else
-                "c:FlRrSst:vw:",
+                "b:c:Fj:lRrSst:vw:",
                 "c:eFlRrSt:w:",
                 "c:eFlrSt:w:"
 #endif /* ifdef DEBUG */
@@ -95,9 +95,9 @@ editor(GS *gp, int argc, char *argv[])
 
         /* Structures shared by screens so stored in the GS structure. */
         TAILQ_INIT(&gp->frefq);
-        TAILQ_INIT(&gp->dcb_store.textq);
         LIST_INIT(&gp->cutq);
         LIST_INIT(&gp->seqq);
+        LIST_INIT(&gp->timerq);
 
         /* Set initial screen type and mode based on the program name. */
         readonly = 0;
@@ -126,7 +126,7 @@ editor(GS *gp, int argc, char *argv[])
 
         /* Parse the arguments. */
         flagchk = '\0';
-        tag_f = wsizearg = NULL;
+        batch_f = jobs_f = tag_f = wsizearg = NULL;
         secure = silent = 0;
         startup = 1;
 
@@ -155,6 +155,9 @@ editor(GS *gp, int argc, char *argv[])
 
         while ((ch = getopt(argc, argv, optstr[pmode])) != -1)
                 switch (ch) {
+                case 'b':               /* Batch script. */
+                        batch_f = optarg;
+                        break;
                 case 'c':               /* Run the command. */
                         /*
                          * XXX
@@ -188,6 +191,9 @@ editor(GS *gp, int argc, char *argv[])
                 case 'F':               /* No snapshot. */
                         F_CLR(gp, G_SNAPSHOT);
                         break;
+                case 'j':               /* Batch workers. */
+                        jobs_f = optarg;
+                        break;
                 case 'R':               /* Readonly. */
                         readonly = 1;
                         break;
@@ -266,6 +272,39 @@ editor(GS *gp, int argc, char *argv[])
         if (LF_ISSET(SC_EX) && F_ISSET(gp, G_SCRIPTED))
                 silent = 1;
 
+        /*
+         * -b implies -s, and doesn't mix with the options that pick the
+         * file to edit.
+         */
+        if (batch_f != NULL) {
+                if (!LF_ISSET(SC_EX)) {
+                        warnx("-b option is only applicable to ex.");
+                        goto err;
+                }
+                if (flagchk != '\0' || gp->c_option != NULL) {
+                        warnx("-b may not be used with -c, -r or -t.");
+                        goto err;
+                }
+                F_SET(gp, G_BATCH);
+                silent = 1;
+        }
+
+        /* -j is the number of batch workers, 0 for one per processor. */
+        jobs = 1;
+        if (jobs_f != NULL) {
+                if (batch_f == NULL) {
+                        warnx("-j option is only applicable with -b.");
+                        goto err;
+                }
+                jobs = strtonum(jobs_f, 0, 1024, &p);
+                if (p != NULL) {
+                        warnx("-j %s: number of jobs is %s.", jobs_f, p);
+                        goto err;
+                }
+                if (jobs == 0 && (jobs = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+                        jobs = 1;
+        }
+
         /*
          * Build and initialize the first/current screen.  This is a bit
          * tricky.  If an error is returned, we may or may not have a
@@ -327,6 +366,16 @@ editor(GS *gp, int argc, char *argv[])
                 }
         }
 
+        /* Run the batch script against the files, and quit. */
+        if (batch_f != NULL) {
+                rval = batch(sp, batch_f, argv, jobs);
+                if (sp->ep != NULL)
+                        (void)file_end(sp, NULL, 1);
+                if (screen_end(sp) || rval)
+                        goto err;
+                goto done;
+        }
+
         /*
          * List recovery files if -r specified without file arguments.
          * Note, options must be initialized and startup information
@@ -432,7 +481,7 @@ editor(GS *gp, int argc, char *argv[])
          */
         if (F_ISSET(sp, SC_SCR_EX)) {
                 p = msg_cmsg(sp, CMSG_CONT_R, &len);
-                (void)write(STDOUT_FILENO, p, len);
+                (void)gp->scr_addstr(sp, p, len);
                 for (;;) {
                         if (v_event_get(sp, &ev, 0, 0))
                                 goto err;
@@ -509,7 +558,7 @@ v_end(GS *gp)
         seq_close(gp);
 
         /* Free default buffer storage. */
-        (void)text_lfree(&gp->dcb_store.textq);
+        cut_free(&gp->dcb_store);
 #endif /* if defined(DEBUG) || defined(PURIFY) */
 
         /* Ring the bell if scheduled. */
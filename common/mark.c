@@ -22,6 +22,7 @@
 
 #include "common.h"
 
+static void mark_bound(EXF *);
 static LMARK *mark_find(SCR *, CHAR_T);
 
 /*
@@ -53,6 +54,15 @@ static LMARK *mark_find(SCR *, CHAR_T);
  * All of these routines translate ABSMARK2 to ABSMARK1.  Setting either of
  * the absolute mark locations sets both, so that "m'" and "m`" work like
  * they, ah, for lack of a better word, "should".
+ *
+ * Every line inserted or deleted potentially moves the marks, and deleting
+ * or reading in a large part of the file does that a line at a time.  So,
+ * the lowest and highest marked lines are tracked, and a change after the
+ * last mark doesn't touch the list.  A change before the first mark moves
+ * all of them by the same amount, which is saved up in the EXF's m_off
+ * field, and applied the next time the list is looked at.  Only changes
+ * in the range of marked lines walk the list.  Anything outside this file
+ * that reads or changes a mark's line number must call mark_flush first.
  */
 
 /*
@@ -71,6 +81,8 @@ mark_init(SCR *sp, EXF *ep)
          * Set up the marks.
          */
         LIST_INIT(&ep->marks);
+        ep->m_off = 0;
+        mark_bound(ep);
         return (0);
 }
 
@@ -110,6 +122,7 @@ mark_get(SCR *sp, CHAR_T key, MARK *mp, mtype_t mtype)
         if (key == ABSMARK2)
                 key = ABSMARK1;
 
+        mark_flush(sp);
         lmp = mark_find(sp, key);
         if (lmp == NULL || lmp->name != key) {
                 msgq(sp, mtype, "Mark %s: not set", KEY_NAME(sp, key));
@@ -157,6 +170,7 @@ mark_set(SCR *sp, CHAR_T key, MARK *value, int userset)
          * an undo, and we set it if it's not already set or if it was set
          * by a previous undo.
          */
+        mark_flush(sp);
         lmp = mark_find(sp, key);
         if (lmp == NULL || lmp->name != key) {
                 MALLOC_RET(sp, lmt, sizeof(LMARK));
@@ -173,9 +187,68 @@ mark_set(SCR *sp, CHAR_T key, MARK *value, int userset)
         lmp->cno = value->cno;
         lmp->name = key;
         lmp->flags = userset ? MARK_USERSET : 0;
+        mark_bound(sp->ep);
         return (0);
 }
 
+/*
+ * mark_flush --
+ *      Apply any saved up line shift to the marks.
+ *
+ * PUBLIC: void mark_flush(SCR *);
+ */
+void
+mark_flush(SCR *sp)
+{
+        EXF *ep;
+        LMARK *lmp;
+
+        ep = sp->ep;
+        if (ep->m_off == 0)
+                return;
+        LIST_FOREACH(lmp, &ep->marks, q)
+                lmp->lno += ep->m_off;
+        ep->m_off = 0;
+}
+
+/*
+ * mark_moveline --
+ *      Move the marks, other than the absolute mark, from one line to
+ *      another.
+ *
+ * PUBLIC: void mark_moveline(SCR *, recno_t, recno_t);
+ */
+void
+mark_moveline(SCR *sp, recno_t from, recno_t to)
+{
+        LMARK *lmp;
+
+        mark_flush(sp);
+        LIST_FOREACH(lmp, &sp->ep->marks, q)
+                if (lmp->name != ABSMARK1 && lmp->lno == from)
+                        lmp->lno = to;
+        mark_bound(sp->ep);
+}
+
+/*
+ * mark_bound --
+ *      Find the lowest and highest marked lines.
+ */
+static void
+mark_bound(EXF *ep)
+{
+        LMARK *lmp;
+
+        ep->m_lo = MAX_REC_NUMBER;
+        ep->m_hi = 0;
+        LIST_FOREACH(lmp, &ep->marks, q) {
+                if (lmp->lno < ep->m_lo)
+                        ep->m_lo = lmp->lno;
+                if (lmp->lno > ep->m_hi)
+                        ep->m_hi = lmp->lno;
+        }
+}
+
 /*
  * mark_find --
  *      Find the requested mark, or, the slot immediately before
@@ -199,22 +272,34 @@ mark_find(SCR *sp, CHAR_T key)
 
 /*
  * mark_insdel --
- *      Update the marks based on an insertion or deletion.
+ *      Update the marks based on an insertion of cnt lines, or a deletion
+ *      of one line.
  *
- * PUBLIC: int mark_insdel(SCR *, lnop_t, recno_t);
+ * PUBLIC: int mark_insdel(SCR *, lnop_t, recno_t, recno_t);
  */
 int
-mark_insdel(SCR *sp, lnop_t op, recno_t lno)
+mark_insdel(SCR *sp, lnop_t op, recno_t lno, recno_t cnt)
 {
+        EXF *ep;
         LMARK *lmp;
         recno_t lline;
 
+        ep = sp->ep;
         switch (op) {
         case LINE_APPEND:
                 /* All insert/append operations are done as inserts. */
                 abort();
         case LINE_DELETE:
-                LIST_FOREACH(lmp, &sp->ep->marks, q)
+                if (lno > ep->m_hi)
+                        break;
+                if (lno < ep->m_lo) {
+                        --ep->m_off;
+                        --ep->m_lo;
+                        --ep->m_hi;
+                        break;
+                }
+                mark_flush(sp);
+                LIST_FOREACH(lmp, &ep->marks, q)
                         if (lmp->lno >= lno) {
                                 if (lmp->lno == lno) {
                                         F_SET(lmp, MARK_DELETED);
@@ -222,6 +307,7 @@ mark_insdel(SCR *sp, lnop_t op, recno_t lno)
                                 } else
                                         --lmp->lno;
                         }
+                mark_bound(ep);
                 break;
         case LINE_INSERT:
                 /*
@@ -236,18 +322,33 @@ mark_insdel(SCR *sp, lnop_t op, recno_t lno)
                  * file and replace it, and continue to use the mark.  Insane,
                  * well, yes, I know, but someone complained.
                  *
-                 * Check for line #2 before going to the end of the file.
+                 * Check for the line after the inserted ones before going to
+                 * the end of the file.  If the file was empty, the first line
+                 * inserted is the replacement, the rest are inserted after it.
                  */
-                if (!db_exist(sp, 2)) {
+                if (lno > ep->m_hi)
+                        break;
+                if (lno == 1 && !db_exist(sp, cnt + 1)) {
                         if (db_last(sp, &lline))
                                 return (1);
-                        if (lline == 1)
-                                return (0);
+                        if (lline == cnt) {
+                                if (--cnt == 0)
+                                        return (0);
+                                ++lno;
+                        }
                 }
 
-                LIST_FOREACH(lmp, &sp->ep->marks, q)
+                if (lno <= ep->m_lo) {
+                        ep->m_off += cnt;
+                        ep->m_lo += cnt;
+                        ep->m_hi += cnt;
+                        break;
+                }
+                mark_flush(sp);
+                LIST_FOREACH(lmp, &ep->marks, q)
                         if (lmp->lno >= lno)
-                                ++lmp->lno;
+                                lmp->lno += cnt;
+                mark_bound(ep);
                 break;
         case LINE_RESET:
                 break;
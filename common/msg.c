@@ -345,14 +345,14 @@ void
 msgq_status(SCR *sp, recno_t lno, u_int flags)
 {
         recno_t last;
-        size_t blen, len;
+        size_t blen, len, lsize;
         int cnt, needsep;
         const char *t;
         char **ap, *bp, *np, *p, *s, *ep;
 
         /* Get sufficient memory. */
         len = strlen(sp->frp->name);
-        GET_SPACE_GOTO(sp, bp, blen, len * MAX_CHARACTER_COLUMNS + 128);
+        GET_SPACE_GOTO(sp, bp, blen, len * MAX_CHARACTER_COLUMNS + 160);
         p = bp;
         ep = bp + blen;
 
@@ -450,6 +450,11 @@ msgq_status(SCR *sp, recno_t lno, u_int flags)
                             (unsigned long)(lno * 100) / last);
                         p += strlen(p);
                 }
+                if ((lsize = log_size(sp)) != 0) {
+                        (void)snprintf(p, ep - p, ", undo %'luK",
+                            (unsigned long)(lsize + 1023) / 1024);
+                        p += strlen(p);
+                }
         } else {
                 if (db_last(sp, &last))
                         last = 0;
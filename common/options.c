@@ -28,9 +28,8 @@
 #include "common.h"
 #include "../vi/vi.h"
 #include "pathnames.h"
+#include "options_hash.h"
 
-static int               opts_abbcmp(const void *, const void *);
-static int               opts_cmp(const void *, const void *);
 static int               opts_print(SCR *, OPTLIST const *);
 
 int f_imctrl (SCR *, OPTION *, char *, u_long *);
@@ -56,6 +55,8 @@ OPTLIST const optlist[] = {
         {"backup",      NULL,           OPT_STR,        0},
 /* O_BEAUTIFY       4BSD */
         {"beautify",    NULL,           OPT_0BOOL,      0},
+/* O_BRACKETPASTE OpenVi */
+        {"bracketpaste",NULL,           OPT_1BOOL,      0},
 /* O_BSERASE      OpenVi */
         {"bserase",     NULL,           OPT_0BOOL,      0},
 /* O_CDPATH       4.4BSD */
@@ -80,6 +81,8 @@ OPTLIST const optlist[] = {
         {"extended",    f_recompile,    OPT_0BOOL,      0},
 /* O_FILEC        4.4BSD */
         {"filec",       NULL,           OPT_STR,        0},
+/* O_FILTERCUT    OpenVi */
+        {"filtercut",   NULL,           OPT_NUM,        0},
 /* O_FLASH          HPUX */
         {"flash",       NULL,           OPT_0BOOL,      0},
 /* O_HARDTABS       4BSD */
@@ -128,6 +131,8 @@ OPTLIST const optlist[] = {
         {"readonly",    f_readonly,     OPT_0BOOL,      OPT_ALWAYS},
 /* O_RECDIR       4.4BSD */
         {"recdir",      NULL,           OPT_STR,        0},
+/* O_RECSYNC      OpenVi */
+        {"recsync",     NULL,           OPT_NUM,        0},
 /* O_REMAP          4BSD */
         {"remap",       NULL,           OPT_1BOOL,      0},
 /* O_REPORT         4BSD */
@@ -174,6 +179,8 @@ OPTLIST const optlist[] = {
         {"timeout",     NULL,           OPT_1BOOL,      0},
 /* O_TTYWERASE    4.4BSD */
         {"ttywerase",   f_ttywerase,    OPT_0BOOL,      0},
+/* O_UNDOLIMIT    OpenVi */
+        {"undolimit",   NULL,           OPT_NUM,        0},
 /* O_VERBOSE      4.4BSD */
         {"verbose",     NULL,           OPT_0BOOL,      0},
 /* O_VISIBLETAB   OpenVi */
@@ -201,50 +208,6 @@ OPTLIST const optlist[] = {
         {NULL},
 };
 
-typedef struct abbrev {
-        char *name;
-        int offset;
-} OABBREV;
-
-static OABBREV const abbrev[] = {
-        {"ai",          O_AUTOINDENT},          /*     4BSD */
-        {"ap",          O_AUTOPRINT},           /*     4BSD */
-        {"aw",          O_AUTOWRITE},           /*     4BSD */
-        {"bf",          O_BEAUTIFY},            /*     4BSD */
-        {"bse",         O_BSERASE},             /*   OpenVi */
-        {"co",          O_COLUMNS},             /*   4.4BSD */
-        {"eb",          O_ERRORBELLS},          /*     4BSD */
-        {"ed",          O_EDCOMPATIBLE},        /*     4BSD */
-        {"et",          O_EXPANDTAB},           /* NetBSD 5.0 */
-        {"ex",          O_EXRC},                /* System V (undocumented) */
-        {"ht",          O_HARDTABS},            /*     4BSD */
-        {"ic",          O_IGNORECASE},          /*     4BSD */
-        {"li",          O_LINES},               /*   4.4BSD */
-        {"nu",          O_NUMBER},              /*     4BSD */
-        {"para",        O_PARAGRAPHS},          /*     4BSD */
-        {"ro",          O_READONLY},            /*     4BSD (undocumented) */
-        {"scr",         O_SCROLL},              /*     4BSD (undocumented) */
-        {"sect",        O_SECTIONS},            /* O'Reilly */
-        {"sh",          O_SHELL},               /*     4BSD */
-        {"sm",          O_SHOWMATCH},           /*     4BSD */
-        {"smd",         O_SHOWMODE},            /*     4BSD */
-        {"sw",          O_SHIFTWIDTH},          /*     4BSD */
-        {"tag",         O_TAGS},                /*     4BSD (undocumented) */
-        {"tl",          O_TAGLENGTH},           /*     4BSD */
-        {"to",          O_TIMEOUT},             /*     4BSD (undocumented) */
-        {"ts",          O_TABSTOP},             /*     4BSD */
-        {"tty",         O_TERM},                /*     4BSD (undocumented) */
-        {"ttytype",     O_TERM},                /*     4BSD (undocumented) */
-        {"vt",          O_VISIBLETAB},          /*   OpenVi */
-        {"w",           O_WINDOW},              /* O'Reilly */
-        {"wa",          O_WRITEANY},            /*     4BSD */
-        {"wi",          O_WINDOW},              /*     4BSD (undocumented) */
-        {"wl",          O_WRAPLEN},             /*   4.4BSD */
-        {"wm",          O_WRAPMARGIN},          /*     4BSD */
-        {"ws",          O_WRAPSCAN},            /*     4BSD */
-        {NULL},
-};
-
 /*
  * opts_init --
  *      Initialize some of the options.
@@ -318,6 +281,7 @@ opts_init(SCR *sp, int *oargs)
         OI(O_PATH, "path=");
         (void)snprintf(b1, sizeof(b1), "recdir=%s", _PATH_PRESERVE);
         OI_b1(O_RECDIR);
+        OI(O_RECSYNC, "recsync=2");
         OI(O_SECTIONS, "sections=NHSHH HUnhshShSs");
         (void)snprintf(b1, sizeof(b1),
             "shell=%s", (s = getenv("SHELL")) == NULL ? _PATH_BSHELL : s);
@@ -979,40 +943,15 @@ opts_save(SCR *sp, FILE *fp)
 OPTLIST const *
 opts_search(char *name)
 {
-        OPTLIST const *op, *found;
-        OABBREV atmp, *ap;
-        OPTLIST otmp;
-        size_t len;
-
-        /* Check list of abbreviations. */
-        atmp.name = name;
-        if ((ap = bsearch(&atmp, abbrev, sizeof(abbrev) / sizeof(OABBREV) - 1,
-            sizeof(OABBREV), opts_abbcmp)) != NULL)
-                return (optlist + ap->offset);
-
-        /* Check list of options. */
-        otmp.name = name;
-        if ((op = bsearch(&otmp, optlist, sizeof(optlist) / sizeof(OPTLIST) - 1,
-            sizeof(OPTLIST), opts_cmp)) != NULL)
-                return (op);
+        int off;
 
         /*
-         * Check to see if the name is the prefix of one (and only one)
-         * option.  If so, return the option.
+         * The table holds the abbreviations, the option names and every
+         * prefix of one (and only one) option name.
          */
-        len = strlen(name);
-        for (found = NULL, op = optlist; op->name != NULL; ++op) {
-                if (op->name[0] < name[0])
-                        continue;
-                if (op->name[0] > name[0])
-                        break;
-                if (!memcmp(op->name, name, len)) {
-                        if (found != NULL)
-                                return (NULL);
-                        found = op;
-                }
-        }
-        return (found);
+        if ((off = phash(&opts_hash, name, strlen(name))) == -1)
+                return (NULL);
+        return (optlist + off);
 }
 
 /*
@@ -1028,18 +967,6 @@ opts_nomatch(SCR *sp, char *name)
             "set: no %s option: 'set all' gives all option values");
 }
 
-static int
-opts_abbcmp(const void *a, const void *b)
-{
-        return(strcmp(((OABBREV *)a)->name, ((OABBREV *)b)->name));
-}
-
-static int
-opts_cmp(const void *a, const void *b)
-{
-        return(strcmp(((OPTLIST *)a)->name, ((OPTLIST *)b)->name));
-}
-
 /*
  * opts_copy --
  *      Copy a screen's OPTION array.
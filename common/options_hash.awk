@@ -0,0 +1,63 @@
+#       Build the option name table for opts_search().
+#
+# The keys are the abbreviations in common/options_abbrev.in, then the
+# option names in common/options.c, then any prefix of an option name
+# that's a prefix of only that option.  The first of them wins.
+
+FILENAME ~ /\.in$/ {
+        if (NF == 0 || $1 ~ /^#/)
+                next;
+        if (NF < 2 || $1 !~ /^[a-z]+$/ || $2 !~ /^O_[0-9A-Z_]+$/) {
+                printf("%s:%d: bad abbreviation\n",
+                    FILENAME, FNR) > "/dev/stderr";
+                err = 1;
+                exit;
+        }
+        AN[++NA] = $1;
+        AS[NA] = $2;
+        next;
+}
+/^\/\* O_[0-9A-Z_]*/ {
+        sym = $2;
+        next;
+}
+sym != "" && match($0, /"[^"]*"/) {
+        N[++NO] = substr($0, RSTART + 1, RLENGTH - 2);
+        S[NO] = sym;
+        sym = "";
+        next;
+}
+END {
+        if (err)
+                exit 1;
+        for (o = 1; o <= NO; o++)
+                OPT[S[o]] = 1;
+        for (a = 1; a <= NA; a++)
+                if (!(AS[a] in OPT)) {
+                        printf("abbreviation %s: unknown option %s\n",
+                            AN[a], AS[a]) > "/dev/stderr";
+                        exit 1;
+                }
+        for (o = 1; o <= NO; o++)
+                for (l = 1; l <= length(N[o]); l++) {
+                        p = substr(N[o], 1, l);
+                        PCNT[p]++;
+                        PSYM[p] = S[o];
+                }
+        for (a = 1; a <= NA; a++)
+                add(AN[a], AS[a]);
+        for (o = 1; o <= NO; o++)
+                add(N[o], S[o]);
+        for (p in PCNT)
+                if (PCNT[p] == 1)
+                        add(p, PSYM[p]);
+        phash_print("opts_hash");
+}
+
+function add(key, sym) {
+        if (key in SEEN)
+                return;
+        SEEN[key] = 1;
+        K[++NK] = key;
+        V[NK] = sym;
+}
@@ -0,0 +1,118 @@
+#       Perfect hash table generator.
+#
+# The caller fills in K[1..NK] with the keys and V[1..NK] with their
+# values, and calls phash_print() to write out a PHTAB for phash(), in
+# common/util.c.  Each key hashes to a bucket, and each bucket gets a
+# displacement that moves all of its keys into empty slots.  The hash
+# functions must match phash() and the PH_MULT_* values in util.h.
+
+function phash_unescape(s,      i, n, r, c) {
+        r = "";
+        for (i = 1; i <= length(s); i++) {
+                c = substr(s, i, 1);
+                if (c == "\\" && substr(s, i + 1, 3) ~ /^[0-7][0-7][0-7]$/) {
+                        n = substr(s, i + 1, 1) * 64 + substr(s, i + 2, 1) * 8;
+                        n += substr(s, i + 3, 1);
+                        c = sprintf("%c", n);
+                        i += 3;
+                }
+                r = r c;
+        }
+        return (r);
+}
+
+function phash_escape(s,        i, c, r) {
+        r = "";
+        for (i = 1; i <= length(s); i++) {
+                c = substr(s, i, 1);
+                if (ORD[c] < 32 || ORD[c] > 126 || c == "\"" || c == "\\")
+                        r = r sprintf("\\%03o", ORD[c]);
+                else
+                        r = r c;
+        }
+        return (r);
+}
+
+function phash_hash(s, mult, mod,       i, h) {
+        h = 0;
+        for (i = 1; i <= length(s); i++)
+                h = (h * mult + ORD[substr(s, i, 1)]) % mod;
+        return (h);
+}
+
+function phash_isprime(n,       i) {
+        for (i = 2; i * i <= n; i++)
+                if (n % i == 0)
+                        return (0);
+        return (n > 1);
+}
+
+function phash_try(size,        b, c, d, i, j, max, ok, slot) {
+        NB = int(NK / 2) + 1;
+        split("", CNT);
+        split("", MEM);
+        split("", SLOT);
+        max = 0;
+        for (i = 1; i <= NK; i++) {
+                b = phash_hash(K[i], 31, NB);
+                HS[i] = phash_hash(K[i], 37, size);
+                ST[i] = phash_hash(K[i], 41, size - 1) + 1;
+                MEM[b, CNT[b]++] = i;
+                if (CNT[b] > max)
+                        max = CNT[b];
+        }
+        for (b = 0; b < NB; b++)
+                DISP[b] = 0;
+
+        # Place the largest buckets first, they're the hardest to fit.
+        for (c = max; c > 0; c--)
+                for (b = 0; b < NB; b++) {
+                        if (CNT[b] != c)
+                                continue;
+                        for (d = 0; d < size; d++) {
+                                split("", TRY);
+                                ok = 1;
+                                for (j = 0; ok && j < c; j++) {
+                                        i = MEM[b, j];
+                                        slot = (HS[i] + d * ST[i]) % size;
+                                        if ((slot in SLOT) || (slot in TRY))
+                                                ok = 0;
+                                        TRY[slot] = i;
+                                }
+                                if (ok)
+                                        break;
+                        }
+                        if (!ok)
+                                return (0);
+                        DISP[b] = d;
+                        for (slot in TRY)
+                                SLOT[slot] = TRY[slot];
+                }
+        return (1);
+}
+
+function phash_print(name,      i, size) {
+        for (i = 1; i < 256; i++)
+                ORD[sprintf("%c", i)] = i;
+
+        for (size = 2 * NK + 1;; size++)
+                if (phash_isprime(size) && phash_try(size))
+                        break;
+
+        printf("/* Generated by common/phash.awk, do not edit. */\n\n");
+        printf("static u_int16_t const %s_disp[] = {", name);
+        for (i = 0; i < NB; i++)
+                printf("%s%d,", i % 10 == 0 ? "\n\t" : " ", DISP[i]);
+        printf("\n};\n\n");
+        printf("static PHENT const %s_ent[] = {\n", name);
+        for (i = 0; i < size; i++)
+                if (i in SLOT)
+                        printf("\t{\"%s\", %d, %s},\n",
+                            phash_escape(K[SLOT[i]]),
+                            length(K[SLOT[i]]), V[SLOT[i]]);
+                else
+                        printf("\t{NULL, 0, 0},\n");
+        printf("};\n\n");
+        printf("static PHTAB const %s = {\n", name);
+        printf("\t%s_ent, %d, %s_disp, %d\n};\n", name, size, name, NB);
+}
@@ -31,8 +31,8 @@
 int
 put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
 {
+        CBLINE *etp, *ltp, *tp;
         CHAR_T name;
-        TEXT *ltp, *tp;
         recno_t lno;
         size_t blen, clen, len;
         int rval;
@@ -41,7 +41,7 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
         if (cbp == NULL) {
                 if (namep == NULL) {
                         cbp = sp->gp->dcbp;
-                        if (cbp == NULL) {
+                        if (cbp == NULL || CB_NLINES(cbp) == 0) {
                                 msgq(sp, M_ERR,
                                     "The default buffer is empty");
                                 return (1);
@@ -49,14 +49,15 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
                 } else {
                         name = *namep;
                         CBNAME(sp, cbp, name);
-                        if (cbp == NULL) {
+                        if (cbp == NULL || CB_NLINES(cbp) == 0) {
                                 msgq(sp, M_ERR, "Buffer %s is empty",
                                     KEY_NAME(sp, name));
                                 return (1);
                         }
                 }
         }
-        tp = TAILQ_FIRST(&cbp->textq);
+        tp = CB_LINE(cbp, 0);
+        etp = tp + CB_NLINES(cbp);
 
         /*
          * It's possible to do a put into an empty file, meaning that the cut
@@ -77,10 +78,9 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
                 if (db_last(sp, &lno))
                         return (1);
                 if (lno == 0) {
-                        for (; tp; ++lno, ++sp->rptlines[L_ADDED],
-                            tp = TAILQ_NEXT(tp, q))
-                                if (db_append(sp, 1, lno, tp->lb, tp->len))
-                                        return (1);
+                        if (db_appendv(sp, 1, lno, tp, etp - tp))
+                                return (1);
+                        sp->rptlines[L_ADDED] += etp - tp;
                         rp->lno = 1;
                         rp->cno = 0;
                         return (0);
@@ -91,10 +91,9 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
         if (F_ISSET(cbp, CB_LMODE)) {
                 lno = append ? cp->lno : cp->lno - 1;
                 rp->lno = lno + 1;
-                for (; tp;
-                    ++lno, ++sp->rptlines[L_ADDED], tp = TAILQ_NEXT(tp, q))
-                        if (db_append(sp, 1, lno, tp->lb, tp->len))
-                                return (1);
+                if (db_appendv(sp, 1, lno, tp, etp - tp))
+                        return (1);
+                sp->rptlines[L_ADDED] += etp - tp;
                 rp->cno = 0;
                 (void)nonblank(sp, rp->lno, &rp->cno);
                 return (0);
@@ -160,7 +159,7 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
          * the intermediate lines, because the line changes will lose
          * the cached line.
          */
-        if (TAILQ_NEXT(tp, q) == NULL) {
+        if (tp + 1 == etp) {
                 if (clen > 0) {
                         memcpy(t, p, clen);
                         t += clen;
@@ -182,7 +181,7 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
                  * Last part of original line; check for space, reset
                  * the pointer into the buffer.
                  */
-                ltp = TAILQ_LAST(&cbp->textq, _texth);
+                ltp = etp - 1;
                 len = t - bp;
                 ADD_SPACE_RET(sp, bp, blen, ltp->len + clen);
                 t = bp + len;
@@ -210,10 +209,10 @@ put(SCR *sp, CB *cbp, CHAR_T *namep, MARK *cp, MARK *rp, int append)
                 }
 
                 /* Output any intermediate lines in the CB. */
-                for (tp = TAILQ_NEXT(tp, q); TAILQ_NEXT(tp, q);
-                    ++lno, ++sp->rptlines[L_ADDED], tp = TAILQ_NEXT(tp, q))
-                        if (db_append(sp, 1, lno, tp->lb, tp->len))
-                                goto err;
+                if (db_appendv(sp, 1, lno, tp + 1, ltp - (tp + 1)))
+                        goto err;
+                lno += ltp - (tp + 1);
+                sp->rptlines[L_ADDED] += ltp - (tp + 1);
 
                 if (db_append(sp, 1, lno, t, clen))
                         goto err;
@@ -90,10 +90,15 @@
  * the DB package can use it for on-disk caching and/or to snapshot the
  * file.  When the file is first modified, the mail recovery file is created,
  * the backing file permissions are updated, the file is sync(2)'d to disk,
- * and the timer is started.  Then, at RCV_PERIOD second intervals, the
- * b+tree file is synced to disk.  RCV_PERIOD is measured using SIGALRM, which
- * means that the data structures (SCR, EXF, the underlying tree structures)
- * must be consistent when the signal arrives.
+ * and the timer is started.  Then, changes are synced to the b+tree file
+ * no more than recsync seconds after they're made: when the timer goes off
+ * while the editor is waiting for input, or at the end of the next command
+ * if the deadline passes while input keeps arriving.  Syncs cost a write of
+ * every dirty page and an fsync, so deferring them keeps that cost off each
+ * keystroke, and each sync covers all of the changes since the last one.
+ * Timers are run from the screen's event loop, so the data structures (SCR,
+ * EXF, the underlying tree structures) are consistent when they go off.
+ * Killer signals, suspending the editor and :preserve sync immediately.
  *
  * The recovery mail file contains normal mail headers, with two additions,
  * which occur in THIS order, as the FIRST TWO headers:
@@ -119,6 +124,11 @@ char *rcv_gets(char *, size_t, int);
 int      rcv_mktemp(SCR *, char *, char *, int);
 int      rcv_openat(SCR *, int, const char *, int *);
 
+static int       rcv_jstop(SCR *);
+static int       rcv_jsync(SCR *);
+
+static TIMER rcv_timer = { .func = rcv_flush };
+
 /*
  * rcv_tmp --
  *      Build a file name that will be used as the recovery file.
@@ -219,6 +229,9 @@ rcv_init(SCR *sp)
                         goto err;
                 }
                 sp->gp->scr_busy(sp, NULL, BUSY_OFF);
+
+                /* Journal later changes, rather than syncing the b+tree. */
+                (void)rcv_jstart(sp);
         }
 
         /* Turn off the owner execute bit. */
@@ -255,11 +268,24 @@ rcv_sync(SCR *sp, u_int flags)
         if (ep == NULL || !F_ISSET(ep, F_RCV_ON))
                 return (0);
 
-        /* Sync the file if it's been modified. */
-        if (F_ISSET(ep, F_MODIFIED)) {
-                /* Clear recovery sync flag. */
+        /*
+         * Sync the file if it's been modified, or if there are changes
+         * waiting to be synced: writing the file elsewhere clears the
+         * modified bit, but the recovery file still needs the changes.
+         */
+        if (F_ISSET(ep, F_MODIFIED | F_RCV_SYNC)) {
+                /* Clear recovery sync flag and deadline. */
                 F_CLR(ep, F_RCV_SYNC);
-                if (ep->db->sync(ep->db, R_RECNOSYNC)) {
+                timespecclear(&ep->rcv_due);
+
+                /*
+                 * A journal is all that needs syncing, unless the b+tree
+                 * is being preserved, mailed or copied.
+                 */
+                if (ep->rcv_jnl != NULL)
+                        (void)rcv_jsync(sp);
+                if ((ep->rcv_jnl == NULL || flags != 0) &&
+                    ep->db->sync(ep->db, R_RECNOSYNC)) {
                         F_CLR(ep, F_RCV_ON | F_RCV_NORM);
                         msgq_str(sp, M_SYSERR,
                             ep->rcv_path, "File backup failed: %s");
@@ -313,6 +339,532 @@ err:            rval = 1;
         return (rval);
 }
 
+/*
+ * rcv_later --
+ *      Sync the file by the recsync deadline, rather than now.
+ *
+ * PUBLIC: void rcv_later(SCR *);
+ */
+void
+rcv_later(SCR *sp)
+{
+        struct timespec now, ts;
+        EXF *ep;
+        u_long secs;
+
+        ep = sp->ep;
+        if ((secs = O_VAL(sp, O_RECSYNC)) == 0) {
+                (void)rcv_sync(sp, 0);
+                return;
+        }
+
+        /* If the deadline has passed, input has kept us busy; sync now. */
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        if (timespecisset(&ep->rcv_due)) {
+                if (!timespeccmp(&now, &ep->rcv_due, <))
+                        (void)rcv_sync(sp, 0);
+                return;
+        }
+
+        /* Set the deadline, and the timer if it's not already earlier. */
+        if (secs > INT_MAX / 1000)
+                secs = INT_MAX / 1000;
+        ts.tv_sec = secs;
+        ts.tv_nsec = 0;
+        timespecadd(&now, &ts, &ep->rcv_due);
+        if (!F_ISSET(&rcv_timer, TIMER_SET) ||
+            timespeccmp(&ep->rcv_due, &rcv_timer.when, <))
+                v_timer_set(sp, &rcv_timer, secs * 1000);
+}
+
+/*
+ * rcv_flush --
+ *      Sync any files with changes waiting to be synced; this is also
+ *      the sync timer's function.
+ *
+ * PUBLIC: void rcv_flush(SCR *);
+ */
+void
+rcv_flush(SCR *sp)
+{
+        GS *gp;
+
+        gp = sp->gp;
+        v_timer_clr(sp, &rcv_timer);
+        TAILQ_FOREACH(sp, &gp->dq, q)
+                if (sp->ep != NULL && F_ISSET(sp->ep, F_RCV_SYNC))
+                        (void)rcv_sync(sp, 0);
+        TAILQ_FOREACH(sp, &gp->hq, q)
+                if (sp->ep != NULL && F_ISSET(sp->ep, F_RCV_SYNC))
+                        (void)rcv_sync(sp, 0);
+}
+
+/*
+ * The recovery journal.
+ *
+ * Syncing the b+tree writes every dirty page and fsync's the whole backing
+ * file, for what's usually a change to a line or two.  So, once the b+tree
+ * has been copied out when the file is first modified, each change is also
+ * appended to a journal, "vi.XXXX.jnl", and a sync only writes and fsync's
+ * the journal.  The journal begins with the path and stat(2) information of
+ * the file the b+tree was read from; recovery reads that file again and
+ * replays the journal onto it, instead of using the b+tree file.  If the
+ * file changes underneath us, or the journal grows RCV_JMAX bytes past the
+ * size of the file, the b+tree is synced and the journal removed, and the
+ * b+tree is recovered as it always was.  Writing the entire file back to
+ * its own name starts a new journal against the new contents.  Temporary
+ * and new files have no copy on disk to replay onto and always sync the
+ * b+tree.
+ *
+ * Each record carries a checksum, so replay stops at a record that was
+ * torn by the crash.  The replay builds a new b+tree file beside the old
+ * one, and only renames it into place once it's synced, so a failed replay
+ * still leaves the old b+tree to recover.  That copy isn't synced while
+ * the journal is kept, and so lacks the changes the journal holds.
+ */
+#define RCV_JMAGIC      "VIJRNL1\n"
+#define RCV_JSUFFIX     ".jnl"
+#define RCV_JBUFSZ      (64 * 1024)     /* Write records at this size. */
+#define RCV_JMAX        (4 * 1024 * 1024)
+
+typedef struct {
+        char     magic[8];              /* RCV_JMAGIC. */
+        dev_t    dev;                   /* Base file device. */
+        ino_t    ino;                   /* Base file inode. */
+        off_t    size;                  /* Base file size. */
+        struct timespec mtim;           /* Base file modification time. */
+        u_int32_t plen;                 /* Base file path length. */
+} RCV_JHDR;
+
+typedef struct {
+        u_int32_t op;                   /* Change: LINE_APPEND, etc. */
+        recno_t   lno;                  /* Line number. */
+        u_int32_t len;                  /* Line length, the line follows. */
+        u_int32_t sum;                  /* Record checksum. */
+} RCV_JREC;
+
+struct _rcv_jnl {
+        int      fd;                    /* Journal file descriptor. */
+        int      error;                 /* Records have been lost. */
+        char    *path;                  /* Journal file name. */
+        char    *base;                  /* Base file name. */
+        char    *tpath;                 /* Replayed b+tree file name. */
+        RCV_JHDR hdr;                   /* Journal header. */
+        char    *buf;                   /* Unwritten records. */
+        size_t   len;                   /* Unwritten records length. */
+        size_t   blen;                  /* Buffer length. */
+        off_t    size;                  /* Journal size. */
+};
+
+static int       rcv_jcheck(RCV_JNL *);
+static u_int32_t rcv_jsum(RCV_JREC *, char *);
+static int       rcv_jwrite(RCV_JNL *, int);
+
+/*
+ * rcv_jstart --
+ *      Start a new journal for the file, which must be unchanged on disk
+ *      since it was last read or written.
+ *
+ * PUBLIC: int rcv_jstart(SCR *);
+ */
+int
+rcv_jstart(SCR *sp)
+{
+        struct stat sb;
+        EXF *ep;
+        RCV_JNL *jp;
+        size_t len;
+        int fd;
+        char base[PATH_MAX], path[PATH_MAX], tpath[PATH_MAX];
+
+        ep = sp->ep;
+        if (ep->rcv_path == NULL || F_ISSET(sp->frp, FR_TMPFILE) ||
+            !F_ISSET(ep, F_DEVSET) || stat(sp->frp->name, &sb) ||
+            !S_ISREG(sb.st_mode) || sb.st_dev != ep->mdev ||
+            sb.st_ino != ep->minode ||
+            timespeccmp(&sb.st_mtim, &ep->mtim, !=) ||
+            realpath(sp->frp->name, base) == NULL)
+                goto err;
+        if ((size_t)snprintf(path, sizeof(path),
+            "%s%s", ep->rcv_path, RCV_JSUFFIX) >= sizeof(path) ||
+            (size_t)snprintf(tpath, sizeof(tpath),
+            "%s.XXXXXX", path) >= sizeof(tpath))
+                goto err;
+
+        if ((jp = ep->rcv_jnl) == NULL) {
+                if ((jp = calloc(1, sizeof(RCV_JNL))) == NULL)
+                        goto err;
+                jp->fd = -1;
+                ep->rcv_jnl = jp;
+        }
+        free(jp->base);
+        if ((jp->base = strdup(base)) == NULL ||
+            (jp->path == NULL && (jp->path = strdup(path)) == NULL))
+                goto err;
+
+        memset(&jp->hdr, 0, sizeof(RCV_JHDR));
+        memcpy(jp->hdr.magic, RCV_JMAGIC, sizeof(jp->hdr.magic));
+        jp->hdr.dev = sb.st_dev;
+        jp->hdr.ino = sb.st_ino;
+        jp->hdr.size = sb.st_size;
+        jp->hdr.mtim = sb.st_mtim;
+        jp->hdr.plen = len = strlen(base);
+
+        /*
+         * Build the new journal under a temporary name and rename it over
+         * any old one, so a crash always leaves one journal that applies.
+         */
+        if ((fd = mkstemp(tpath)) == -1)
+                goto err;
+        if (write(fd, &jp->hdr, sizeof(RCV_JHDR)) != sizeof(RCV_JHDR) ||
+            write(fd, base, len) != (ssize_t)len || fsync(fd) ||
+            rename(tpath, jp->path)) {
+                (void)close(fd);
+                (void)unlink(tpath);
+                goto err;
+        }
+        if (jp->fd != -1)
+                (void)close(jp->fd);
+        jp->fd = fd;
+        jp->error = 0;
+        jp->len = 0;
+        jp->size = sizeof(RCV_JHDR) + len;
+        return (0);
+
+        /* If there was a journal, it no longer applies. */
+err:    if (ep->rcv_jnl != NULL)
+                (void)rcv_jstop(sp);
+        return (1);
+}
+
+/*
+ * rcv_jnl --
+ *      Add a change to the journal.
+ *
+ * PUBLIC: void rcv_jnl(SCR *, lnop_t, recno_t, char *, size_t);
+ */
+void
+rcv_jnl(SCR *sp, lnop_t op, recno_t lno, char *p, size_t len)
+{
+        RCV_JNL *jp;
+        RCV_JREC rec;
+        size_t nlen, need;
+        char *bp;
+
+        jp = sp->ep->rcv_jnl;
+        if (jp->error)
+                return;
+
+        need = sizeof(RCV_JREC) + len;
+        if (jp->len != 0 && jp->len + need > RCV_JBUFSZ &&
+            rcv_jwrite(jp, 0)) {
+                jp->error = 1;
+                return;
+        }
+        if (jp->len + need > jp->blen) {
+                nlen = jp->blen == 0 ? 1024 : jp->blen;
+                while (nlen < jp->len + need)
+                        nlen <<= 1;
+                if ((bp = realloc(jp->buf, nlen)) == NULL) {
+                        jp->error = 1;
+                        return;
+                }
+                jp->buf = bp;
+                jp->blen = nlen;
+        }
+
+        rec.op = op;
+        rec.lno = lno;
+        rec.len = len;
+        rec.sum = rcv_jsum(&rec, p);
+        memcpy(jp->buf + jp->len, &rec, sizeof(RCV_JREC));
+        if (len != 0)
+                memcpy(jp->buf + jp->len + sizeof(RCV_JREC), p, len);
+        jp->len += need;
+        jp->size += need;
+}
+
+/*
+ * rcv_jsync --
+ *      Write the journal to disk; if it can't be trusted any longer, sync
+ *      the b+tree instead, and stop journaling.
+ */
+static int
+rcv_jsync(SCR *sp)
+{
+        RCV_JNL *jp;
+
+        jp = sp->ep->rcv_jnl;
+        if (jp->error || rcv_jcheck(jp) ||
+            jp->size > jp->hdr.size + RCV_JMAX || rcv_jwrite(jp, 1))
+                return (rcv_jstop(sp));
+        return (0);
+}
+
+/*
+ * rcv_jend --
+ *      Close the journal, optionally removing it.
+ *
+ * PUBLIC: void rcv_jend(EXF *, int);
+ */
+void
+rcv_jend(EXF *ep, int remove)
+{
+        RCV_JNL *jp;
+
+        if ((jp = ep->rcv_jnl) == NULL)
+                return;
+        if (jp->fd != -1)
+                (void)close(jp->fd);
+        if (remove && jp->path != NULL)
+                (void)unlink(jp->path);
+        if (jp->tpath != NULL)
+                (void)unlink(jp->tpath);
+        free(jp->tpath);
+        free(jp->path);
+        free(jp->base);
+        free(jp->buf);
+        free(jp);
+        ep->rcv_jnl = NULL;
+}
+
+/*
+ * rcv_jopen --
+ *      Open the journal of a file being recovered, if there's one that
+ *      applies, and return the name of the file to replay it onto, and
+ *      in *bfnamep, the name of the new b+tree file to build.
+ *
+ * PUBLIC: char *rcv_jopen(SCR *, EXF *, char **);
+ */
+char *
+rcv_jopen(SCR *sp, EXF *ep, char **bfnamep)
+{
+        struct stat sb;
+        RCV_JNL *jp;
+        RCV_JREC rec;
+        size_t off;
+        ssize_t nr;
+        int fd;
+        char path[PATH_MAX], tpath[PATH_MAX];
+
+        /*
+         * !!!
+         * ep MAY NOT BE THE SAME AS sp->ep, DON'T USE THE LATTER.
+         */
+        if ((size_t)snprintf(path, sizeof(path),
+            "%s%s", ep->rcv_path, RCV_JSUFFIX) >= sizeof(path) ||
+            (size_t)snprintf(tpath, sizeof(tpath),
+            "%s.XXXXXX", ep->rcv_path) >= sizeof(tpath))
+                return (NULL);
+        if ((jp = calloc(1, sizeof(RCV_JNL))) == NULL) {
+                msgq(sp, M_SYSERR, NULL);
+                return (NULL);
+        }
+        ep->rcv_jnl = jp;
+        if ((jp->path = strdup(path)) == NULL) {
+                msgq(sp, M_SYSERR, NULL);
+                goto err;
+        }
+        if ((jp->fd = open(path, O_RDWR)) == -1) {
+                if (errno != ENOENT)
+                        msgq_str(sp, M_SYSERR, path, "%s");
+                goto err;
+        }
+
+        /* Check the header, and that the file hasn't changed. */
+        if (read(jp->fd, &jp->hdr, sizeof(RCV_JHDR)) != sizeof(RCV_JHDR) ||
+            memcmp(jp->hdr.magic, RCV_JMAGIC, sizeof(jp->hdr.magic)) ||
+            jp->hdr.plen == 0 || jp->hdr.plen >= PATH_MAX ||
+            (jp->base = malloc(jp->hdr.plen + 1)) == NULL ||
+            read(jp->fd, jp->base, jp->hdr.plen) != (ssize_t)jp->hdr.plen)
+                goto bad;
+        jp->base[jp->hdr.plen] = '\0';
+        if (rcv_jcheck(jp))
+                goto bad;
+
+        /* Read the records, keeping those that are intact. */
+        if (fstat(jp->fd, &sb))
+                goto bad;
+        jp->size = sizeof(RCV_JHDR) + jp->hdr.plen;
+        jp->blen = sb.st_size > jp->size ? sb.st_size - jp->size : 0;
+        if (jp->blen != 0) {
+                if ((jp->buf = malloc(jp->blen)) == NULL)
+                        goto bad;
+                if ((nr = read(jp->fd, jp->buf, jp->blen)) == -1)
+                        goto bad;
+                jp->blen = nr;
+        }
+        for (off = 0; off + sizeof(RCV_JREC) <= jp->blen;
+            off += sizeof(RCV_JREC) + rec.len) {
+                memcpy(&rec, jp->buf + off, sizeof(RCV_JREC));
+                if (rec.op > LINE_RESET ||
+                    rec.len > jp->blen - off - sizeof(RCV_JREC) ||
+                    rcv_jsum(&rec, jp->buf + off + sizeof(RCV_JREC)) !=
+                    rec.sum)
+                        break;
+        }
+        jp->len = off;
+        jp->size += off;
+
+        /* Lose any torn record, new ones are appended. */
+        if (ftruncate(jp->fd, jp->size) ||
+            lseek(jp->fd, jp->size, SEEK_SET) == -1)
+                goto bad;
+
+        /* The b+tree is rebuilt from the file, in a new file. */
+        if ((fd = mkstemp(tpath)) == -1)
+                goto bad;
+        (void)close(fd);
+        if ((jp->tpath = strdup(tpath)) == NULL) {
+                (void)unlink(tpath);
+                goto bad;
+        }
+        *bfnamep = jp->tpath;
+        return (jp->base);
+
+bad:    msgq_str(sp, M_ERR, path,
+            "%s: recovery journal unusable, recovering a stale copy");
+        rcv_jend(ep, 1);
+        return (NULL);
+
+err:    rcv_jend(ep, 0);
+        return (NULL);
+}
+
+/*
+ * rcv_jreplay --
+ *      Replay the journal onto the file being recovered.
+ *
+ * PUBLIC: int rcv_jreplay(SCR *, EXF *);
+ */
+int
+rcv_jreplay(SCR *sp, EXF *ep)
+{
+        DBT data, key;
+        RCV_JNL *jp;
+        RCV_JREC rec;
+        size_t off;
+        int rval;
+
+        /*
+         * !!!
+         * ep MAY NOT BE THE SAME AS sp->ep, DON'T USE THE LATTER.
+         *
+         * Read the entire file while we know it matches the journal.
+         */
+        jp = ep->rcv_jnl;
+        if (ep->db->seq(ep->db, &key, &data, R_LAST) == -1)
+                goto err;
+
+        for (off = 0; off < jp->len; off += sizeof(RCV_JREC) + rec.len) {
+                memcpy(&rec, jp->buf + off, sizeof(RCV_JREC));
+                key.data = &rec.lno;
+                key.size = sizeof(rec.lno);
+                data.data = jp->buf + off + sizeof(RCV_JREC);
+                data.size = rec.len;
+                switch (rec.op) {
+                case LINE_APPEND:
+                        rval = ep->db->put(ep->db, &key, &data, R_IAFTER);
+                        break;
+                case LINE_DELETE:
+                        rval = ep->db->del(ep->db, &key, 0);
+                        break;
+                case LINE_INSERT:
+                        rval = ep->db->put(ep->db, &key, &data, R_IBEFORE);
+                        break;
+                case LINE_RESET:
+                        rval = ep->db->put(ep->db, &key, &data, 0);
+                        break;
+                default:
+                        abort();
+                }
+                if (rval == -1)
+                        goto err;
+        }
+        jp->len = 0;
+
+        /* Replace the old b+tree once the new one is on disk. */
+        if (ep->db->sync(ep->db, R_RECNOSYNC) ||
+            rename(jp->tpath, ep->rcv_path))
+                goto err;
+        free(jp->tpath);
+        jp->tpath = NULL;
+        return (0);
+
+err:    msgq_str(sp, M_SYSERR, jp->path, "%s: replay");
+        return (1);
+}
+
+/*
+ * rcv_jstop --
+ *      Sync the b+tree and stop journaling.
+ */
+static int
+rcv_jstop(SCR *sp)
+{
+        int rval;
+
+        rval = sp->ep->db->sync(sp->ep->db, R_RECNOSYNC);
+        rcv_jend(sp->ep, 1);
+        return (rval);
+}
+
+/*
+ * rcv_jcheck --
+ *      Check that the journal's base file is unchanged.
+ */
+static int
+rcv_jcheck(RCV_JNL *jp)
+{
+        struct stat sb;
+
+        return (stat(jp->base, &sb) || sb.st_dev != jp->hdr.dev ||
+            sb.st_ino != jp->hdr.ino || sb.st_size != jp->hdr.size ||
+            timespeccmp(&sb.st_mtim, &jp->hdr.mtim, !=));
+}
+
+/*
+ * rcv_jwrite --
+ *      Write the buffered journal records, optionally fsync'ing them.
+ */
+static int
+rcv_jwrite(RCV_JNL *jp, int dosync)
+{
+        ssize_t nw;
+        char *p;
+
+        for (p = jp->buf; jp->len > 0; p += nw, jp->len -= nw)
+                if ((nw = write(jp->fd, p, jp->len)) == -1) {
+                        if (errno == EINTR)
+                                nw = 0;
+                        else
+                                return (1);
+                }
+        return (dosync ? fsync(jp->fd) : 0);
+}
+
+/*
+ * rcv_jsum --
+ *      Checksum a journal record (32-bit FNV-1a).
+ */
+static u_int32_t
+rcv_jsum(RCV_JREC *rp, char *p)
+{
+        u_int32_t h, v[3];
+        size_t i;
+        u_char *s;
+
+        v[0] = rp->op;
+        v[1] = rp->lno;
+        v[2] = rp->len;
+        h = 2166136261U;
+        for (s = (u_char *)v, i = 0; i < sizeof(v); ++i)
+                h = (h ^ s[i]) * 16777619U;
+        for (s = (u_char *)p, i = 0; i < rp->len; ++i)
+                h = (h ^ s[i]) * 16777619U;
+        return (h);
+}
+
 /*
  * rcv_mailfile --
  *      Build the file to mail to the user.
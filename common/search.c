@@ -410,6 +410,84 @@ err:    if (LF_ISSET(SEARCH_MSG))
         return (rval);
 }
 
+/*
+ * o_search --
+ *      Do a search outward from a line, alternately looking forward and
+ *      backward, and return the first match on the nearest matching line.
+ *      Used for tags that carry a line number hint, so a tag near the end
+ *      of a large file doesn't mean reading it from the top.
+ *
+ * PUBLIC: int o_search(SCR *, MARK *, MARK *, char *, size_t, u_int);
+ */
+int
+o_search(SCR *sp, MARK *fm, MARK *rm, char *ptrn, size_t plen, u_int flags)
+{
+        recno_t dist, lno;
+        regmatch_t match[1];
+        size_t len;
+        int back, cnt, eval, fwd, i;
+        char *l;
+
+        if (search_init(sp, FORWARD, ptrn, plen, NULL, flags))
+                return (1);
+
+        /*
+         * Check the starting line, then the lines after and before it in
+         * turn, until running off both ends of the file.
+         */
+        for (cnt = INTERRUPT_CHECK, back = fwd = 1, i = 0; back || fwd; ++i) {
+                dist = (i + 1) / 2;
+                if (i & 1) {
+                        if (!fwd)
+                                continue;
+                        lno = fm->lno + dist;
+                } else {
+                        if (!back)
+                                continue;
+                        if (dist >= fm->lno) {
+                                back = 0;
+                                continue;
+                        }
+                        lno = fm->lno - dist;
+                }
+                if (cnt-- == 0) {
+                        if (INTERRUPTED(sp))
+                                return (1);
+                        cnt = INTERRUPT_CHECK;
+                }
+                if (db_get(sp, lno, 0, &l, &len)) {
+                        if (i & 1)
+                                fwd = 0;
+                        continue;
+                }
+
+                /* Search the line. */
+                match[0].rm_so = 0;
+                match[0].rm_eo = len;
+                eval = regexec(&sp->re_c, l, 1, match, REG_STARTEND);
+                if (eval == REG_NOMATCH)
+                        continue;
+                if (eval != 0) {
+                        if (LF_ISSET(SEARCH_MSG))
+                                re_error(sp, eval, &sp->re_c);
+                        else
+                                (void)sp->gp->scr_bell(sp);
+                        return (1);
+                }
+
+                rm->lno = lno;
+                rm->cno = match[0].rm_so;
+
+                /* See comment in f_search(). */
+                if (!LF_ISSET(SEARCH_EOL) && rm->cno >= len)
+                        rm->cno = len != 0 ? len - 1 : 0;
+                return (0);
+        }
+        if (LF_ISSET(SEARCH_MSG))
+                search_msg(sp, S_NOTFOUND);
+        return (1);
+}
+
 /*
  * search_msg --
  *      Display one of the search messages.
@@ -24,6 +24,11 @@
 
 #define MINIMUM(a, b)   (((a) < (b)) ? (a) : (b))
 
+static int  seq_tchild(SEQ_NODE *, CHAR_T, size_t *);
+static int  seq_tins(SCR *, SEQ *);
+static void seq_tdel(SEQ_NODE **, CHAR_T *, size_t);
+static void seq_tfree(SEQ_NODE *);
+
 /*
  * seq_set --
  *      Internal version to enter a sequence.
@@ -112,10 +117,23 @@ mem1:           errno = sv_errno;
                 LIST_INSERT_AFTER(lastqp, qp, q);
         }
 
+        /* Enter it into the lookup trie. */
+        if (!F_ISSET(qp, SEQ_FUNCMAP) && seq_tins(sp, qp)) {
+                sv_errno = errno;
+                LIST_REMOVE(qp, q);
+                free(qp->output);
+                free(qp->input);
+                goto mem3;
+        }
+
         /* Set the fast lookup bit. */
         if (qp->input[0] < MAX_BIT_SEQ)
                 bit_set(sp->gp->seqb, qp->input[0]);
 
+        /* Lookups never need more keys than the longest input. */
+        if (ilen > sp->gp->seqmax)
+                sp->gp->seqmax = ilen;
+
         return (0);
 }
 
@@ -132,18 +150,20 @@ seq_delete(SCR *sp, CHAR_T *input, size_t ilen, seq_t stype)
 
         if ((qp = seq_find(sp, NULL, NULL, input, ilen, stype, NULL)) == NULL)
                 return (1);
-        return (seq_mdel(qp));
+        return (seq_mdel(sp->gp, qp));
 }
 
 /*
  * seq_mdel --
  *      Delete a map entry, without lookup.
  *
- * PUBLIC: int seq_mdel(SEQ *);
+ * PUBLIC: int seq_mdel(GS *, SEQ *);
  */
 int
-seq_mdel(SEQ *qp)
+seq_mdel(GS *gp, SEQ *qp)
 {
+        if (!F_ISSET(qp, SEQ_FUNCMAP))
+                seq_tdel(&gp->seqt[qp->stype], qp->input, qp->ilen);
         LIST_REMOVE(qp, q);
         free(qp->name);
         free(qp->input);
@@ -164,7 +184,9 @@ SEQ *
 seq_find(SCR *sp, SEQ **lastqp, EVENT *e_input, CHAR_T *c_input, size_t ilen,
     seq_t stype, int *ispartialp)
 {
+        SEQ_NODE *np;
         SEQ *lqp, *qp;
+        size_t i, n;
         int diff;
 
         /*
@@ -179,6 +201,33 @@ seq_find(SCR *sp, SEQ **lastqp, EVENT *e_input, CHAR_T *c_input, size_t ilen,
          */
         if (ispartialp != NULL)
                 *ispartialp = 0;
+
+        /*
+         * Walk the trie one key at a time.  The first sequence on the
+         * path is the shortest one that's a prefix of the input, which
+         * is the one the terminal key routine wants.  Running out of
+         * input at a node with children is a partial match.
+         *
+         * Entering a sequence needs the list position, which only the
+         * list search below provides.
+         */
+        if (lastqp == NULL) {
+                for (np = sp->gp->seqt[stype], i = 0;
+                    np != NULL && i < ilen; ++i) {
+                        if (!seq_tchild(np, e_input == NULL ?
+                            c_input[i] : e_input[i].e_c, &n))
+                                return (NULL);
+                        np = np->child[n];
+                        if (ispartialp != NULL && np->qp != NULL)
+                                return (np->qp);
+                }
+                if (np == NULL || i == 0)
+                        return (NULL);
+                if (ispartialp != NULL && np->nchild != 0)
+                        *ispartialp = 1;
+                return (ispartialp == NULL ? np->qp : NULL);
+        }
+
         for (lqp = NULL, qp = LIST_FIRST(&sp->gp->seqq);
             qp != NULL; lqp = qp, qp = LIST_NEXT(qp, q)) {
                 /*
@@ -243,6 +292,7 @@ void
 seq_close(GS *gp)
 {
         SEQ *qp;
+        int i;
 
         while ((qp = LIST_FIRST(&gp->seqq)) != NULL) {
                 free(qp->name);
@@ -251,6 +301,10 @@ seq_close(GS *gp)
                 LIST_REMOVE(qp, q);
                 free(qp);
         }
+        for (i = 0; i <= SEQ_INPUT; ++i) {
+                seq_tfree(gp->seqt[i]);
+                gp->seqt[i] = NULL;
+        }
 }
 
 /*
@@ -358,3 +412,134 @@ e_memcmp(CHAR_T *p1, EVENT *ep, size_t n)
         }
         return (0);
 }
+
+/*
+ * seq_tchild --
+ *      Find a key in a trie node's children; return if found, and set
+ *      the index of the key or where it would go.
+ */
+static int
+seq_tchild(SEQ_NODE *np, CHAR_T ch, size_t *np_off)
+{
+        size_t base, lim, mid;
+
+        for (base = 0, lim = np->nchild; lim > base;) {
+                mid = base + (lim - base) / 2;
+                if (np->ch[mid] == ch) {
+                        *np_off = mid;
+                        return (1);
+                }
+                if (np->ch[mid] < ch)
+                        base = mid + 1;
+                else
+                        lim = mid;
+        }
+        *np_off = base;
+        return (0);
+}
+
+/*
+ * seq_tins --
+ *      Enter a sequence into its type's trie; the caller reports errors.
+ */
+static int
+seq_tins(SCR *sp, SEQ *qp)
+{
+        SEQ_NODE **npp, *np, *cnp, **child;
+        CHAR_T *ch;
+        size_t i, n, nlen;
+        int sv_errno;
+
+        npp = &sp->gp->seqt[qp->stype];
+        if (*npp == NULL && (*npp = calloc(1, sizeof(SEQ_NODE))) == NULL)
+                return (1);
+        for (np = *npp, i = 0; i < qp->ilen; ++i, np = np->child[n]) {
+                if (seq_tchild(np, qp->input[i], &n))
+                        continue;
+
+                /* Grow the child arrays, allocating the node first. */
+                if ((cnp = calloc(1, sizeof(SEQ_NODE))) == NULL)
+                        goto err;
+                if (np->nchild == np->mchild) {
+                        nlen = np->mchild == 0 ? 4 : np->mchild * 2;
+                        if ((ch = reallocarray(np->ch,
+                            nlen, sizeof(CHAR_T))) == NULL) {
+                                free(cnp);
+                                goto err;
+                        }
+                        np->ch = ch;
+                        if ((child = reallocarray(np->child,
+                            nlen, sizeof(SEQ_NODE *))) == NULL) {
+                                free(cnp);
+                                goto err;
+                        }
+                        np->child = child;
+                        np->mchild = nlen;
+                }
+                memmove(np->ch + n + 1,
+                    np->ch + n, (np->nchild - n) * sizeof(CHAR_T));
+                memmove(np->child + n + 1,
+                    np->child + n, (np->nchild - n) * sizeof(SEQ_NODE *));
+                np->ch[n] = qp->input[i];
+                np->child[n] = cnp;
+                ++np->nchild;
+        }
+        np->qp = qp;
+        return (0);
+
+        /* Discard any empty nodes entered on the way down. */
+err:    sv_errno = errno;
+        seq_tdel(npp, qp->input, i);
+        errno = sv_errno;
+        return (1);
+}
+
+/*
+ * seq_tdel --
+ *      Remove a sequence from a trie, freeing nodes left empty.
+ */
+static void
+seq_tdel(SEQ_NODE **npp, CHAR_T *p, size_t len)
+{
+        SEQ_NODE *np;
+        size_t n;
+
+        if ((np = *npp) == NULL)
+                return;
+        if (len == 0)
+                np->qp = NULL;
+        else if (seq_tchild(np, p[0], &n)) {
+                seq_tdel(&np->child[n], p + 1, len - 1);
+                if (np->child[n] == NULL) {
+                        --np->nchild;
+                        memmove(np->ch + n,
+                            np->ch + n + 1, (np->nchild - n) * sizeof(CHAR_T));
+                        memmove(np->child + n, np->child + n + 1,
+                            (np->nchild - n) * sizeof(SEQ_NODE *));
+                }
+        }
+        if (np->qp == NULL && np->nchild == 0) {
+                free(np->ch);
+                free(np->child);
+                free(np);
+                *npp = NULL;
+        }
+}
+
+/*
+ * seq_tfree --
+ *      Discard a trie.
+ */
+static void
+seq_tfree(SEQ_NODE *np)
+{
+        size_t n;
+
+        if (np == NULL)
+                return;
+        for (n = 0; n < np->nchild; ++n)
+                seq_tfree(np->child[n]);
+        free(np->ch);
+        free(np->child);
+        free(np);
+}
@@ -25,6 +25,11 @@
  * The name and the output fields of a SEQ can be empty, i.e. NULL.
  * Only the input field is required.
  *
+ * Lookups don't use the list, each sequence type has a trie of the input
+ * keys, so finding a sequence takes a step per key no matter how many
+ * sequences there are.  Unresolved function key maps aren't in the tries,
+ * they can't match anything.
+ *
  * XXX
  * The fast-lookup bits are never turned off -- users don't usually unmap
  * things, though, so it's probably not a big deal.
@@ -45,3 +50,16 @@ struct _seq {
 #define SEQ_USERDEF     0x08            /* If user defined. */
         u_int8_t flags;
 };
+
+/*
+ * A trie node has the sequence whose input ends at the node, if any, and
+ * the nodes for the next key, sorted by key.  Nodes with neither are freed,
+ * so a node with children means a longer sequence may match.
+ */
+struct _seq_node {
+        SEQ      *qp;                   /* Sequence ending here. */
+        CHAR_T   *ch;                   /* Child keys, sorted. */
+        SEQ_NODE **child;               /* Child nodes. */
+        size_t    nchild;               /* Child count. */
+        size_t    mchild;               /* Child slots allocated. */
+};
@@ -150,6 +150,31 @@ nget_slong(long *valp, const char *p, char **endp, int base)
         return (NUM_ERR);
 }
 
+/*
+ * phash --
+ *      Look up a key in a perfect hash table, returning its value, or -1
+ *      if it's not there.
+ *
+ * PUBLIC: int phash(PHTAB const *, const char *, size_t);
+ */
+int
+phash(PHTAB const *tp, const char *key, size_t len)
+{
+        PHENT const *ep;
+        u_int b, h, s;
+        size_t i;
+
+        for (b = h = s = i = 0; i < len; ++i) {
+                b = (b * PH_MULT_BUCKET + (u_char)key[i]) % tp->nbucket;
+                h = (h * PH_MULT_SLOT + (u_char)key[i]) % tp->nent;
+                s = (s * PH_MULT_STEP + (u_char)key[i]) % (tp->nent - 1);
+        }
+        ep = tp->ent + (h + tp->disp[b] * (s + 1)) % tp->nent;
+        if (ep->key == NULL || ep->len != len || memcmp(ep->key, key, len))
+                return (-1);
+        return (ep->val);
+}
+
 #ifdef DEBUG
 # include <stdarg.h>
 
@@ -27,12 +27,16 @@
 
 #include "../common/common.h"
 #include "../vi/vi.h"
+#include "ex_hash.h"
 
 #if defined(DEBUG) && defined(COMLOG)
 static void     ex_comlog(SCR *, EXCMD *);
 #endif /* if defined(DEBUG) && defined(COMLOG) */
 static EXCMDLIST const *
                 ex_comm_search(char *, size_t);
+static void     ex_cache_free(EXCMD *);
+static EXCACHE *ex_cache_get(EXCMD *, size_t);
+static void     ex_cache_put(EXCMD *, size_t, recno_t, int);
 static int      ex_discard(SCR *);
 static int      ex_line(SCR *, EXCMD *, MARK *, int *, int *);
 static int      ex_load(SCR *);
@@ -134,7 +138,7 @@ ex(SCR **spp)
 
                 /* Sync recovery if changes were made. */
                 if (F_ISSET(sp->ep, F_RCV_SYNC))
-                        rcv_sync(sp, 0);
+                        rcv_later(sp);
 
                 /*
                  * If the last command caused a restart, or switched screens
@@ -194,11 +198,12 @@ ex_cmd(SCR *sp)
 {
         enum nresult nret;
         EX_PRIVATE *exp;
+        EXCACHE *xp;
         EXCMD *ecp;
         GS *gp;
         MARK cur;
-        recno_t lno;
-        size_t arg1_len, discard, len;
+        recno_t if_lno, lno;
+        size_t arg1_len, cmd_off, discard, len;
         u_int32_t flags;
         long ltmp;
         int at_found, gv_found;
@@ -354,6 +359,28 @@ loop:   ecp = LIST_FIRST(&gp->ecq);
                         break;
         }
 
+        /*
+         * If an @ or global command has run this command before, pick up
+         * its parse instead of parsing the command name and arguments
+         * again.  See the comment in ex.h.
+         */
+        newscreen = 0;
+        xp = NULL;
+        cmd_off = 0;
+        if_lno = ecp->if_lno;
+        if (FL_ISSET(ecp->agv_flags, AGV_ALL)) {
+                cmd_off = ecp->cp - ecp->o_cp;
+                if ((xp = ex_cache_get(ecp, cmd_off)) != NULL) {
+                        if (xp->cmd == NULL) {
+                                ecp->rcmd = xp->rcmd;
+                                ecp->cmd = &ecp->rcmd;
+                        } else
+                                ecp->cmd = xp->cmd;
+                        p = ecp->cp;
+                        goto skip_srch;
+                }
+        }
+
         /*
          * If no command, ex does the last specified of p, l, or #, and vi
          * moves to the line.  Otherwise, determine the length of the command
@@ -375,7 +402,6 @@ loop:   ecp = LIST_FIRST(&gp->ecq);
          * command for each separator.
          */
 #define SINGLE_CHAR_COMMANDS    "\004!#&*<=>@~"
-        newscreen = 0;
         if (ecp->clen != 0 && ecp->cp[0] != '|' && ecp->cp[0] != '\n') {
                 if (strchr(SINGLE_CHAR_COMMANDS, *ecp->cp)) {
                         p = ecp->cp;
@@ -624,6 +650,19 @@ skip_srch:      if (ecp->cmd == &cmds[C_VISUAL_EX] && F_ISSET(sp, SC_VI))
          */
         discard = 0;            /* Characters discarded from the command. */
         arg1_len = 0;
+        if (xp != NULL) {
+                memcpy(ecp->o_cp + xp->argoff, xp->arg, xp->arglen);
+                ecp->cp = ecp->o_cp + xp->argoff;
+                ecp->clen = xp->arglen;
+                ecp->save_cmd = ecp->o_cp + xp->nextoff;
+                ecp->save_cmdlen = xp->nextlen;
+                gp->if_lno += xp->if_lno;
+                ecp->if_lno += xp->if_lno;
+                if (xp->endnl)
+                        F_SET(ecp, E_NEWLINE);
+                vi_address = xp->vi_address;
+                goto parsed;
+        }
         ecp->save_cmd = ecp->cp;
         if (ecp->cmd == &cmds[C_EDIT] || ecp->cmd == &cmds[C_EX] ||
             ecp->cmd == &cmds[C_NEXT] || ecp->cmd == &cmds[C_VISUAL_VI]) {
@@ -816,6 +855,20 @@ skip_srch:      if (ecp->cmd == &cmds[C_VISUAL_EX] && F_ISSET(sp, SC_VI))
                         if (*p == '\\')
                                 *p = CH_LITERAL;
 
+        /*
+         * Save the parse for the next time an @ or global command runs
+         * this command.  Default commands, commands that switch screens
+         * or files, and commands that have already started building the
+         * argument list aren't worth the trouble.  Shifts are parsed from
+         * the command name, which a cached parse skips.
+         */
+        if (FL_ISSET(ecp->agv_flags, AGV_ALL) &&
+            !F_ISSET(ecp, E_USELASTCMD) && !newscreen && arg1_len == 0 &&
+            exp->argsoff == 0 && ecp->cmd != &cmds[C_VISUAL_EX] &&
+            ecp->cmd != &cmds[C_VISUAL_VI] &&
+            ecp->cmd != &cmds[C_SHIFTL] && ecp->cmd != &cmds[C_SHIFTR])
+                ex_cache_put(ecp, cmd_off, ecp->if_lno - if_lno, vi_address);
+
         /*
          * Set the default addresses.  It's an error to specify an address for
          * a command that doesn't take them.  If two addresses are specified
@@ -834,7 +887,7 @@ skip_srch:      if (ecp->cmd == &cmds[C_VISUAL_EX] && F_ISSET(sp, SC_VI))
          * (ex: z) care if the user specified an address or if we just used
          * the current cursor.
          */
-        switch (F_ISSET(ecp, E_ADDR1 | E_ADDR2 | E_ADDR2_ALL | E_ADDR2_NONE)) {
+parsed: switch (F_ISSET(ecp, E_ADDR1 | E_ADDR2 | E_ADDR2_ALL | E_ADDR2_NONE)) {
         case E_ADDR1:                           /* One address: */
                 switch (ecp->addrcnt) {
                 case 0:                         /* Default cursor/empty file. */
@@ -2084,7 +2137,8 @@ ex_load(SCR *sp)
                 if (FL_ISSET(ecp->agv_flags, AGV_ALL)) {
                         /* Discard any exhausted ranges. */
                         while ((rp = TAILQ_FIRST(&ecp->rq))) {
-                                if (rp->start > rp->stop) {
+                                if (RANGE_START(ecp, rp) >
+                                    RANGE_STOP(ecp, rp)) {
                                         TAILQ_REMOVE(&ecp->rq, rp, q);
                                         free(rp);
                                 } else
@@ -2108,6 +2162,7 @@ ex_load(SCR *sp)
                                 }
                         }
                         free(ecp->o_cp);
+                        ex_cache_free(ecp);
                 }
 
                 /* Discard the EXCMD. */
@@ -2124,7 +2179,8 @@ ex_load(SCR *sp)
         ecp->cp = ecp->o_cp;
         memcpy(ecp->cp, ecp->cp + ecp->o_clen, ecp->o_clen);
         ecp->clen = ecp->o_clen;
-        ecp->range_lno = sp->lno = rp->start++;
+        ecp->range_lno = sp->lno = RANGE_START(ecp, rp);
+        ++rp->start;
 
         if (FL_ISSET(ecp->agv_flags, AGV_GLOBAL | AGV_V))
                 F_SET(sp, SC_EX_GLOBAL);
@@ -2153,6 +2209,7 @@ ex_discard(SCR *sp)
                                 free(rp);
                         }
                         free(ecp->o_cp);
+                        ex_cache_free(ecp);
                 }
                 LIST_REMOVE(ecp, q);
                 free(ecp);
@@ -2161,6 +2218,89 @@ ex_discard(SCR *sp)
         return (0);
 }
 
+/*
+ * ex_cache_get --
+ *      Find the parse of the command at an offset into an @ or global
+ *      command's text.
+ */
+static EXCACHE *
+ex_cache_get(EXCMD *ecp, size_t off)
+{
+        EXCACHE *xp;
+        size_t base, lim;
+
+        /* The commands are parsed, so cached, in the order of the text. */
+        for (base = 0, lim = ecp->ncache; lim != 0; lim >>= 1) {
+                xp = ecp->cache + base + (lim >> 1);
+                if (xp->off == off)
+                        return (xp);
+                if (xp->off < off) {
+                        base += (lim >> 1) + 1;
+                        --lim;
+                }
+        }
+        return (NULL);
+}
+
+/*
+ * ex_cache_put --
+ *      Save the parse of the current command of an @ or global command.
+ *      The cache is only an optimization, failures are ignored.
+ */
+static void
+ex_cache_put(EXCMD *ecp, size_t off, recno_t if_lno, int vi_address)
+{
+        EXCACHE *xp;
+        size_t n;
+        char *arg;
+
+        if (ecp->ncache != 0 && ecp->cache[ecp->ncache - 1].off >= off)
+                return;
+        if (ecp->ncache == ecp->mcache) {
+                n = ecp->mcache == 0 ? 4 : ecp->mcache * 2;
+                if ((xp = reallocarray(ecp->cache,
+                    n, sizeof(EXCACHE))) == NULL)
+                        return;
+                ecp->cache = xp;
+                ecp->mcache = n;
+        }
+        if ((arg = malloc(ecp->clen + 1)) == NULL)
+                return;
+        memcpy(arg, ecp->cp, ecp->clen);
+
+        xp = ecp->cache + ecp->ncache++;
+        xp->off = off;
+        xp->argoff = ecp->cp - ecp->o_cp;
+        xp->nextoff = ecp->save_cmd - ecp->o_cp;
+        xp->nextlen = ecp->save_cmdlen;
+        xp->arg = arg;
+        xp->arglen = ecp->clen;
+        if (ecp->cmd == &ecp->rcmd) {
+                xp->rcmd = ecp->rcmd;
+                xp->cmd = NULL;
+        } else
+                xp->cmd = ecp->cmd;
+        xp->if_lno = if_lno;
+        xp->endnl = F_ISSET(ecp, E_NEWLINE) ? 1 : 0;
+        xp->vi_address = vi_address;
+}
+
+/*
+ * ex_cache_free --
+ *      Discard the parsed commands of an @ or global command.
+ */
+static void
+ex_cache_free(EXCMD *ecp)
+{
+        size_t n;
+
+        for (n = 0; n < ecp->ncache; ++n)
+                free(ecp->cache[n].arg);
+        free(ecp->cache);
+        ecp->cache = NULL;
+        ecp->ncache = ecp->mcache = 0;
+}
+
 /*
  * ex_unknown --
  *      Display an unknown command name.
@@ -2222,6 +2362,22 @@ ex_is_unmap(char *name, size_t len)
             cp == &cmds[C_UNMAP]);
 }
 
+/*
+ * ex_is_tag -
+ *      The vi text input routine needs to know if ex thinks this is a
+ *      tag command, so it can complete tag names rather than file names.
+ *
+ * PUBLIC: int ex_is_tag(char *, size_t);
+ */
+int
+ex_is_tag(char *name, size_t len)
+{
+        EXCMDLIST const *cp;
+
+        return ((cp = ex_comm_search(name, len)) != NULL &&
+            cp == &cmds[C_TAG]);
+}
+
 /*
  * ex_comm_search --
  *      Search for a command name.
@@ -2229,17 +2385,15 @@ ex_is_unmap(char *name, size_t len)
 static EXCMDLIST const *
 ex_comm_search(char *name, size_t len)
 {
-        EXCMDLIST const *cp;
+        int off;
 
-        for (cp = cmds; cp->name != NULL; ++cp) {
-                if (cp->name[0] > name[0])
-                        return (NULL);
-                if (cp->name[0] != name[0])
-                        continue;
-                if (strlen(cp->name) >= len && !memcmp(name, cp->name, len))
-                        return (cp);
-        }
-        return (NULL);
+        /*
+         * Every prefix of a command name is in the table, mapped to the
+         * first command in cmds[] that it's a prefix of.
+         */
+        if ((off = phash(&ex_hash, name, len)) == -1)
+                return (NULL);
+        return (cmds + off);
 }
 
 /*
@@ -73,6 +73,31 @@ struct _range {                         /* Global command range. */
         recno_t start, stop;            /* Start/stop of the range. */
 };
 
+/* Range line numbers are relative to the command's range_off field. */
+#define RANGE_START(ecp, rp)    ((recno_t)((rp)->start + (ecp)->range_off))
+#define RANGE_STOP(ecp, rp)     ((recno_t)((rp)->stop + (ecp)->range_off))
+
+/*
+ * Parsed command cache for @ and global commands.  The command text is the
+ * same each time the command is run, so the command name lookup and the
+ * quoting and termination passes over the arguments are only done once,
+ * for each command at a given offset into the text.
+ */
+typedef struct _excache EXCACHE;
+struct _excache {
+        size_t    off;                  /* Offset of the command name. */
+        size_t    argoff;               /* Offset of the arguments. */
+        size_t    nextoff;              /* Offset of the next command. */
+        size_t    nextlen;              /* Length of the next command(s). */
+        char     *arg;                  /* Parsed arguments. */
+        size_t    arglen;               /* Parsed arguments length. */
+        EXCMDLIST const *cmd;           /* Command: table entry, or NULL. */
+        EXCMDLIST rcmd;                 /* Command: replacement if NULL. */
+        recno_t   if_lno;               /* Escaped <newline>s. */
+        int       endnl;                /* Found ending <newline>. */
+        int       vi_address;           /* Text follows the command. */
+};
+
 /* Ex command structure. */
 struct _excmd {
         LIST_ENTRY(_excmd) q;           /* Linked list of commands. */
@@ -96,8 +121,12 @@ struct _excmd {
 
         TAILQ_HEAD(_rh, _range) rq;     /* @/global range: linked list. */
         recno_t   range_lno;            /* @/global range: set line number. */
+        recno_t   range_off;            /* @/global range: line offset. */
         char     *o_cp;                 /* Original @/global command. */
         size_t    o_clen;               /* Original @/global command length. */
+        EXCACHE  *cache;                /* @/global parsed commands. */
+        size_t    ncache;               /* @/global parsed command count. */
+        size_t    mcache;               /* @/global parsed command slots. */
 #define AGV_AT          0x01            /* @ buffer execution. */
 #define AGV_AT_NORANGE  0x02            /* @ buffer execution without range. */
 #define AGV_GLOBAL      0x04            /* global command. */
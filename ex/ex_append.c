@@ -150,7 +150,8 @@ ex_aci(SCR *sp, EXCMD *cmdp, enum which cmd)
                     len = cmdp->save_cmdlen; len > 0; p = t) {
                         for (t = p; len > 0 && t[0] != '\n'; ++t, --len);
                         if (t != p || len == 0) {
-                                if (F_ISSET(sp, SC_EX_GLOBAL) &&
+                                if ((F_ISSET(sp, SC_EX_GLOBAL) ||
+                                    F_ISSET(gp, G_BATCH)) &&
                                     t - p == 1 && p[0] == '.') {
                                         ++t;
                                         if (len > 0)
@@ -168,8 +169,8 @@ ex_aci(SCR *sp, EXCMD *cmdp, enum which cmd)
                         }
                 }
                 /*
-                 * If there's any remaining text, we're in a global, and
-                 * there's more command to parse.
+                 * If there's any remaining text, we're in a global or a
+                 * batch script, and there's more command to parse.
                  *
                  * !!!
                  * We depend on the fact that non-global commands will eat the
@@ -183,7 +184,11 @@ ex_aci(SCR *sp, EXCMD *cmdp, enum which cmd)
                 cmdp->save_cmdlen = len;
         }
 
-        if (F_ISSET(sp, SC_EX_GLOBAL)) {
+        /*
+         * A batch script is read like a script on the standard input, so
+         * its text input ends at a '.' line, or at the end of the script.
+         */
+        if (F_ISSET(sp, SC_EX_GLOBAL) || F_ISSET(gp, G_BATCH)) {
                 if ((sp->lno = lno) == 0 && db_exist(sp, 1))
                         sp->lno = 1;
                 return (0);
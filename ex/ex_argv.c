@@ -547,6 +547,38 @@ argv_lexp(SCR *sp, EXCMD *excp, char *path)
         return (0);
 }
 
+/*
+ * argv_uniq --
+ *      Sort the arguments appended since off, and discard duplicates.
+ *
+ * PUBLIC: int argv_uniq(SCR *, EXCMD *, int);
+ */
+int
+argv_uniq(SCR *sp, EXCMD *excp, int off)
+{
+        ARGS *ap;
+        EX_PRIVATE *exp;
+        int i, n;
+
+        exp = EXP(sp);
+        if (exp->argsoff - off < 2)
+                return (0);
+        qsort(exp->args + off, exp->argsoff - off, sizeof(ARGS *), argv_comp);
+        for (n = i = off + 1; i < exp->argsoff; ++i) {
+                if (!strcmp((char *)exp->args[i]->bp,
+                    (char *)exp->args[n - 1]->bp))
+                        continue;
+                ap = exp->args[n];
+                exp->args[n++] = exp->args[i];
+                exp->args[i] = ap;
+        }
+        exp->argsoff = n;
+        exp->args[n]->len = 0;
+        excp->argv = exp->args;
+        excp->argc = exp->argsoff;
+        return (0);
+}
+
 /*
  * argv_comp --
  *      Alphabetic comparison.
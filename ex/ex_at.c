@@ -34,11 +34,11 @@ int
 ex_at(SCR *sp, EXCMD *cmdp)
 {
         CB *cbp;
+        CBLINE *tp;
         CHAR_T name;
         EXCMD *ecp;
         RANGE *rp;
-        TEXT *tp;
-        size_t len;
+        size_t cnt, len;
         char *p;
 
         /*
@@ -58,7 +58,7 @@ ex_at(SCR *sp, EXCMD *cmdp)
         F_SET(sp, SC_AT_SET);
 
         CBNAME(sp, cbp, name);
-        if (cbp == NULL) {
+        if (cbp == NULL || CB_NLINES(cbp) == 0) {
                 ex_emsg(sp, KEY_NAME(sp, name), EXM_EMPTYBUF);
                 return (1);
         }
@@ -100,9 +100,8 @@ ex_at(SCR *sp, EXCMD *cmdp)
          * ex parser may step on the command string when it's parsing it.
          */
         len = 0;
-        TAILQ_FOREACH_REVERSE(tp, &cbp->textq, _texth, q) {
-                len += tp->len + 1;
-        }
+        for (cnt = CB_NLINES(cbp); cnt-- > 0;)
+                len += CB_LINE(cbp, cnt)->len + 1;
 
         MALLOC_RET(sp, ecp->cp, len * 2);
         ecp->o_cp = ecp->cp;
@@ -111,7 +110,8 @@ ex_at(SCR *sp, EXCMD *cmdp)
 
         /* Copy the buffer into the command space. */
         p = ecp->cp + len;
-        TAILQ_FOREACH_REVERSE(tp, &cbp->textq, _texth, q) {
+        for (cnt = CB_NLINES(cbp); cnt-- > 0;) {
+                tp = CB_LINE(cbp, cnt);
                 memcpy(p, tp->lb, tp->len);
                 p += tp->len;
                 *p++ = '\n';
@@ -144,8 +144,8 @@ EXCMDLIST const cmds[] = {
 /* C_DISPLAY */
         {"display",     ex_display,     0,
             "w1r",
-            "display b[uffers] | s[creens] | t[ags]",
-            "display buffers, screens or tags"},
+            "display b[uffers] | o[utput] | s[creens] | t[ags]",
+            "display buffers, output statistics, screens or tags"},
 /* C_EDIT */
         {"edit",        ex_edit,        E_NEWSCREEN,
             "f1o",
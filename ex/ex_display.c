@@ -26,9 +26,9 @@ static int      bdisplay(SCR *);
 static void     db(SCR *, CB *, CHAR_T *);
 
 /*
- * ex_display -- :display b[uffers] | s[creens] | t[ags]
+ * ex_display -- :display b[uffers] | o[utput] | s[creens] | t[ags]
  *
- *      Display buffers, tags or screens.
+ *      Display buffers, terminal output statistics, tags or screens.
  *
  * PUBLIC: int ex_display(SCR *, EXCMD *);
  */
@@ -43,6 +43,17 @@ ex_display(SCR *sp, EXCMD *cmdp)
                     memcmp(cmdp->argv[0]->bp, ARG, cmdp->argv[0]->len))
                         break;
                 return (bdisplay(sp));
+        case 'o':
+#undef  ARG
+#define ARG     "output"
+                if (cmdp->argv[0]->len >= sizeof(ARG) ||
+                    memcmp(cmdp->argv[0]->bp, ARG, cmdp->argv[0]->len))
+                        break;
+                if (sp->gp->scr_ostat == NULL) {
+                        msgq(sp, M_INFO, "No output statistics to display");
+                        return (0);
+                }
+                return (sp->gp->scr_ostat(sp));
         case 's':
 #undef  ARG
 #define ARG     "screens"
@@ -81,7 +92,7 @@ bdisplay(SCR *sp)
         LIST_FOREACH(cbp, &sp->gp->cutq, q) {
                 if (isdigit(cbp->name))
                         continue;
-                if (!TAILQ_EMPTY(&cbp->textq))
+                if (CB_NLINES(cbp) != 0)
                         db(sp, cbp, NULL);
                 if (INTERRUPTED(sp))
                         return (0);
@@ -90,7 +101,7 @@ bdisplay(SCR *sp)
         LIST_FOREACH(cbp, &sp->gp->cutq, q) {
                 if (!isdigit(cbp->name))
                         continue;
-                if (!TAILQ_EMPTY(&cbp->textq))
+                if (CB_NLINES(cbp) != 0)
                         db(sp, cbp, NULL);
                 if (INTERRUPTED(sp))
                         return (0);
@@ -108,14 +119,15 @@ bdisplay(SCR *sp)
 static void
 db(SCR *sp, CB *cbp, CHAR_T *name)
 {
+        CBLINE *tp;
         CHAR_T *p;
-        TEXT *tp;
-        size_t len;
+        size_t cnt, len;
 
         (void)ex_printf(sp, "********** %s%s\n",
             name == NULL ? KEY_NAME(sp, cbp->name) : name,
             F_ISSET(cbp, CB_LMODE) ? " (line mode)" : " (character mode)");
-        TAILQ_FOREACH(tp, &cbp->textq, q) {
+        for (cnt = 0; cnt < CB_NLINES(cbp); ++cnt) {
+                tp = CB_LINE(cbp, cnt);
                 for (len = tp->len, p = tp->lb; len--; ++p) {
                         (void)ex_puts(sp, KEY_NAME(sp, *p));
                         if (INTERRUPTED(sp))
@@ -20,6 +20,8 @@
 #include <errno.h>
 #include <bsd_fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <bsd_stdlib.h>
 #include <bsd_string.h>
@@ -29,6 +31,15 @@
 
 #undef open
 
+/* Pipe I/O chunk size for FILTER_BANG. */
+#define FILTER_BUFSZ    (64 * 1024)
+
+/* If the replaced lines are copied into the unnamed buffer. */
+#define FILTER_CUT(sp, fm, tm)                                          \
+        (O_VAL((sp), O_FILTERCUT) == 0 ||                               \
+        (tm)->lno - (fm)->lno < O_VAL((sp), O_FILTERCUT))
+
+static int filter_bang(SCR *, MARK *, MARK *, int, int, recno_t *);
 static int filter_ldisplay(SCR *, FILE *);
 
 /*
@@ -47,8 +58,8 @@ ex_filter(SCR *sp, EXCMD *cmdp, MARK *fm, MARK *tm, MARK *rp, char *cmd,
         FILE *ifp, *ofp;
         pid_t parent_writer_pid, utility_pid;
         recno_t nread;
-        int input[2], output[2], fd, rval;
-        char *name, tname[] = "/tmp/vi.XXXXXX";
+        int input[2], output[2], rval;
+        char *name;
 
         rval = 0;
 
@@ -81,40 +92,7 @@ ex_filter(SCR *sp, EXCMD *cmdp, MARK *fm, MARK *tm, MARK *rp, char *cmd,
         ofp = NULL;
         input[0] = input[1] = output[0] = output[1] = -1;
 
-        if (ftype == FILTER_BANG) {
-                fd = mkstemp(tname);
-                if (fd == -1) {
-                        msgq(sp, M_SYSERR,
-                            "Unable to create temporary file");
-                        if (fd != -1) {
-                                (void)close(fd);
-                                (void)unlink(tname);
-                        }
-                        goto err;
-                }
-                if (unlink(tname) == -1)
-                        msgq(sp, M_SYSERR, "unlink");
-                if ((ifp = fdopen(fd, "w")) == NULL) {
-                        msgq(sp, M_SYSERR, "fdopen");
-                        (void)close(fd);
-                        goto err;
-                }
-                if ((input[0] = dup(fd)) == -1) {
-                        msgq(sp, M_SYSERR, "dup");
-                        (void)fclose(ifp);
-                        goto err;
-                }
-                /*
-                 * Write the selected lines into the temporary file.
-                 * This instance of ifp is closed by ex_writefp.
-                 */
-                if (ex_writefp(sp, "filter", ifp, fm, tm, NULL, NULL, 1))
-                        goto err;
-                if (lseek(input[0], 0, SEEK_SET) == -1) {
-                        msgq(sp, M_SYSERR, "lseek");
-                        goto err;
-                }
-        } else if (ftype != FILTER_READ && pipe(input) < 0) {
+        if (ftype != FILTER_READ && pipe(input) < 0) {
                 msgq(sp, M_SYSERR, "pipe");
                 goto err;
         }
@@ -124,7 +102,7 @@ ex_filter(SCR *sp, EXCMD *cmdp, MARK *fm, MARK *tm, MARK *rp, char *cmd,
                 msgq(sp, M_SYSERR, "pipe");
                 goto err;
         }
-        if ((ofp = fdopen(output[0], "r")) == NULL) {
+        if (ftype != FILTER_BANG && (ofp = fdopen(output[0], "r")) == NULL) {
                 msgq(sp, M_SYSERR, "fdopen");
                 goto err;
         }
@@ -291,29 +269,25 @@ err:            if (input[0] != -1)
         /*
          * FILTER_BANG
          *
-         * Here we need a temporary file because our database lacks locking.
-         *
-         * XXX
-         * Temporary files are expensive and we'd like to avoid disk I/O.
-         * When the DB code has locking, we should treat vi as if it were
-         * multiple applications sharing a database, and do the required
-         * locking.  If necessary a work-around would be to do explicit
-         * locking in the line.c:db_get() code, based on F_MULTILOCK flag set
-         * here.
+         * Here we need both a reader and a writer, and the output replaces
+         * the lines being written.  Filter_bang streams the lines to the
+         * utility and appends its output after them, then the original
+         * lines are deleted.  Filter_bang closes both pipe ends.
          */
         if (ftype == FILTER_BANG) {
-                /*
-                 * Read the output from the read end of the output
-                 * pipe.  Ex_readfp appends to the MARK and closes
-                 * ofp.
-                 */
-                if (ex_readfp(sp, "filter", ofp, tm, &nread, 1))
+                if (filter_bang(sp, fm, tm, input[1], output[0], &nread))
                         rval = 1;
                 sp->rptlines[L_ADDED] += nread;
 
-                /* Delete any lines written to the utility. */
+                /*
+                 * Delete any lines written to the utility.  They're copied
+                 * into the unnamed buffer first, unless there are more
+                 * of them than the filtercut option allows, in which case
+                 * the undo log is the only copy.
+                 */
                 if (rval == 0 &&
-                    (cut(sp, NULL, fm, tm, CUT_LINEMODE) ||
+                    ((FILTER_CUT(sp, fm, tm) &&
+                    cut(sp, NULL, fm, tm, CUT_LINEMODE)) ||
                     del(sp, fm, tm, 1))) {
                         rval = 1;
                         goto uwait;
@@ -337,6 +311,157 @@ uwait:  return (proc_wait(sp, utility_pid, cmd,
             ftype == FILTER_READ && F_ISSET(sp, SC_VI) ? 1 : 0, 0) || rval);
 }
 
+/*
+ * filter_bang --
+ *      Write a range of lines to a utility and append its output after
+ *      the range.
+ *
+ * There's no second process: the lines are written and the output read
+ * from a single poll(2) loop, so neither pipe can fill up and starve the
+ * other, and nothing goes through a temporary file.  We get away without
+ * locking the underlying database because the output is appended after
+ * tm, which never renumbers the lines still waiting to be written.
+ */
+static int
+filter_bang(SCR *sp, MARK *fm, MARK *tm, int wfd, int rfd, recno_t *nreadp)
+{
+        struct pollfd pfd[2];
+        struct sigaction act, oact;
+        CBLINE *lp;
+        recno_t lno, n, nread;
+        size_t lblen, len, rblen, rlen, wblen, wlen, woff;
+        ssize_t nr, nw;
+        int nfds, rval;
+        char *ep, *p, *q, *rbp, *wbp;
+
+        lp = NULL;
+        rbp = wbp = NULL;
+        lblen = rblen = rlen = wblen = wlen = woff = 0;
+        nread = 0;
+        rval = 0;
+
+        /*
+         * A utility that exits without reading all of its input isn't an
+         * error, so catch the write failure instead of dying of SIGPIPE.
+         */
+        memset(&act, 0, sizeof(act));
+        act.sa_handler = SIG_IGN;
+        sigemptyset(&act.sa_mask);
+        (void)sigaction(SIGPIPE, &act, &oact);
+
+        (void)fcntl(wfd, F_SETFL, fcntl(wfd, F_GETFL) | O_NONBLOCK);
+        (void)fcntl(rfd, F_SETFL, fcntl(rfd, F_GETFL) | O_NONBLOCK);
+
+        for (lno = tm->lno == 0 ? 1 : fm->lno; rfd != -1;) {
+                if (INTERRUPTED(sp))
+                        break;
+
+                /*
+                 * Refill the write buffer.  The lines have to be copied,
+                 * appending the output discards the line cache.
+                 */
+                if (wfd != -1 && woff == wlen) {
+                        for (woff = wlen = 0; lno <= tm->lno; ++lno) {
+                                if (db_get(sp, lno, DBG_FATAL, &p, &len))
+                                        goto err;
+                                if (wlen != 0 && wlen + len + 1 > FILTER_BUFSZ)
+                                        break;
+                                BINC_GOTO(sp, wbp, wblen, wlen + len + 1);
+                                memcpy(wbp + wlen, p, len);
+                                wlen += len;
+                                wbp[wlen++] = '\n';
+                        }
+                        if (wlen == 0) {
+                                (void)close(wfd);
+                                wfd = -1;
+                        }
+                }
+
+                pfd[0].fd = rfd;
+                pfd[0].events = POLLIN;
+                pfd[0].revents = 0;
+                nfds = 1;
+                if (wfd != -1) {
+                        pfd[1].fd = wfd;
+                        pfd[1].events = POLLOUT;
+                        pfd[1].revents = 0;
+                        nfds = 2;
+                }
+                if (poll(pfd, nfds, -1) == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        msgq(sp, M_SYSERR, "poll");
+                        goto err;
+                }
+
+                if (nfds == 2 && pfd[1].revents != 0) {
+                        nw = write(wfd, wbp + woff, wlen - woff);
+                        if (nw != -1)
+                                woff += nw;
+                        else if (errno == EPIPE) {
+                                (void)close(wfd);
+                                wfd = -1;
+                        } else if (errno != EAGAIN && errno != EINTR) {
+                                msgq(sp, M_SYSERR, "filter write");
+                                goto err;
+                        }
+                }
+
+                if (pfd[0].revents == 0)
+                        continue;
+                BINC_GOTO(sp, rbp, rblen, rlen + FILTER_BUFSZ);
+                if ((nr = read(rfd, rbp + rlen, FILTER_BUFSZ)) == -1) {
+                        if (errno == EAGAIN || errno == EINTR)
+                                continue;
+                        msgq(sp, M_SYSERR, "filter read");
+                        goto err;
+                }
+                if (nr == 0) {
+                        (void)close(rfd);
+                        rfd = -1;
+                }
+                rlen += nr;
+
+                /*
+                 * Append the complete lines, and at EOF any trailing
+                 * partial line, in a single batch.
+                 */
+                for (n = 0, p = rbp, ep = rbp + rlen;; ++n) {
+                        if ((q = memchr(p, '\n', ep - p)) == NULL) {
+                                if (rfd != -1 || p == ep)
+                                        break;
+                                q = ep;
+                        }
+                        BINC_GOTO(sp, lp, lblen, (n + 1) * sizeof(CBLINE));
+                        lp[n].lb = p;
+                        lp[n].len = q - p;
+                        p = q == ep ? ep : q + 1;
+                }
+                if (n != 0 && db_appendv(sp, 1, tm->lno + nread, lp, n))
+                        goto err;
+                nread += n;
+                if ((rlen = ep - p) != 0)
+                        memmove(rbp, p, rlen);
+        }
+
+        if (0) {
+alloc_err:      msgq(sp, M_SYSERR, NULL);
+err:            rval = 1;
+        }
+        if (wfd != -1)
+                (void)close(wfd);
+        if (rfd != -1)
+                (void)close(rfd);
+        (void)sigaction(SIGPIPE, &oact, NULL);
+
+        free(lp);
+        free(rbp);
+        free(wbp);
+
+        *nreadp = nread;
+        return (rval);
+}
+
 /*
  * filter_ldisplay --
  *      Display output from a utility.
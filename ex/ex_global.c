@@ -243,15 +243,22 @@ usage:          ex_emsg(sp, cmdp->cmd->usage, EXM_USAGE);
 
 /*
  * ex_g_insdel --
- *      Update the ranges based on an insertion or deletion.
+ *      Update the ranges based on an insertion of cnt lines, or a deletion
+ *      of one line.
  *
- * PUBLIC: int ex_g_insdel(SCR *, lnop_t, recno_t);
+ * The range line numbers are relative to the command's range_off field, so
+ * the ranges after the changed line, almost always all of them, since the
+ * command is run on each range in turn, are moved by changing range_off.
+ * Only the ranges before the line are walked, to undo the change for them.
+ *
+ * PUBLIC: int ex_g_insdel(SCR *, lnop_t, recno_t, recno_t);
  */
 int
-ex_g_insdel(SCR *sp, lnop_t op, recno_t lno)
+ex_g_insdel(SCR *sp, lnop_t op, recno_t lno, recno_t cnt)
 {
         EXCMD *ecp;
-        RANGE *nrp, *rp;
+        RANGE *nrp, *rp, *trp;
+        recno_t off;
 
         /* All insert/append operations are done as inserts. */
         if (op == LINE_APPEND)
@@ -263,26 +270,21 @@ ex_g_insdel(SCR *sp, lnop_t op, recno_t lno)
         LIST_FOREACH(ecp, &sp->gp->ecq, q) {
                 if (!FL_ISSET(ecp->agv_flags, AGV_AT | AGV_GLOBAL | AGV_V))
                         continue;
-                for (rp = TAILQ_FIRST(&ecp->rq); rp != NULL; rp = nrp) {
+                for (trp = NULL,
+                    rp = TAILQ_FIRST(&ecp->rq); rp != NULL; rp = nrp) {
                         nrp = TAILQ_NEXT(rp, q);
 
                         /* If range less than the line, ignore it. */
-                        if (rp->stop < lno)
+                        if (RANGE_STOP(ecp, rp) < lno)
                                 continue;
 
                         /*
-                         * If range greater than the line, decrement or
-                         * increment the range.
+                         * If range greater than the line, it and the ranges
+                         * after it are decremented or incremented.
                          */
-                        if (rp->start > lno) {
-                                if (op == LINE_DELETE) {
-                                        --rp->start;
-                                        --rp->stop;
-                                } else {
-                                        ++rp->start;
-                                        ++rp->stop;
-                                }
-                                continue;
+                        if (RANGE_START(ecp, rp) > lno) {
+                                trp = rp;
+                                break;
                         }
 
                         /*
@@ -292,18 +294,34 @@ ex_g_insdel(SCR *sp, lnop_t op, recno_t lno)
                          * element, neither range can be exhausted.
                          */
                         if (op == LINE_DELETE) {
-                                if (rp->start > --rp->stop) {
+                                --rp->stop;
+                                if (RANGE_START(ecp, rp) >
+                                    RANGE_STOP(ecp, rp)) {
                                         TAILQ_REMOVE(&ecp->rq, rp, q);
                                         free(rp);
                                 }
                         } else {
-                                CALLOC_RET(sp, nrp, 1, sizeof(RANGE));
-                                nrp->start = lno + 1;
-                                nrp->stop = rp->stop + 1;
-                                rp->stop = lno - 1;
-                                TAILQ_INSERT_AFTER(&ecp->rq, rp, nrp, q);
-                                rp = nrp;
-                                (void)rp;
+                                CALLOC_RET(sp, trp, 1, sizeof(RANGE));
+                                trp->start = lno + cnt - ecp->range_off;
+                                trp->stop = rp->stop + cnt;
+                                rp->stop = lno - 1 - ecp->range_off;
+                                TAILQ_INSERT_AFTER(&ecp->rq, rp, trp, q);
+                        }
+                        trp = nrp;
+                        break;
+                }
+
+                /*
+                 * Move the ranges from trp on by changing the offset, and
+                 * move the ones before it back.
+                 */
+                if (trp != NULL) {
+                        off = op == LINE_DELETE ? (recno_t)-1 : cnt;
+                        ecp->range_off += off;
+                        for (rp = TAILQ_FIRST(&ecp->rq);
+                            rp != trp; rp = TAILQ_NEXT(rp, q)) {
+                                rp->start -= off;
+                                rp->stop -= off;
                         }
                 }
 
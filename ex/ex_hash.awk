@@ -0,0 +1,27 @@
+#       Build the ex command name table for ex_comm_search().
+#
+# Every prefix of a command name is a key, and maps to the first command
+# in the cmds[] table that it's a prefix of.
+
+/^\/\* C_[0-9A-Z_]* \*\// {
+        sym = $2;
+        next;
+}
+sym != "" && match($0, /"[^"]*"/) {
+        N[++NC] = phash_unescape(substr($0, RSTART + 1, RLENGTH - 2));
+        S[NC] = sym;
+        sym = "";
+        next;
+}
+END {
+        for (c = 1; c <= NC; c++)
+                for (l = 1; l <= length(N[c]); l++) {
+                        p = substr(N[c], 1, l);
+                        if (p in SEEN)
+                                continue;
+                        SEEN[p] = 1;
+                        K[++NK] = p;
+                        V[NK] = S[c];
+                }
+        phash_print("ex_hash");
+}
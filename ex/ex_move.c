@@ -47,7 +47,6 @@ ex_copy(SCR *sp, EXCMD *cmdp)
         fm1 = cmdp->addr1;
         fm2 = cmdp->addr2;
         memset(&cb, 0, sizeof(cb));
-        TAILQ_INIT(&cb.textq);
         for (cnt = fm1.lno; cnt <= fm2.lno; ++cnt)
                 if (cut_line(sp, cnt, 0, CUT_LINE_TO_EOL, &cb)) {
                         rval = 1;
@@ -70,7 +69,7 @@ ex_copy(SCR *sp, EXCMD *cmdp)
                 sp->lno = m.lno + (cnt - 1);
                 sp->cno = 0;
         }
-err:    text_lfree(&cb.textq);
+err:    cut_free(&cb);
         return (rval);
 }
 
@@ -119,6 +118,7 @@ ex_move(SCR *sp, EXCMD *cmdp)
 
         /* Log the old positions of the marks. */
         mark_reset = 0;
+        mark_flush(sp);
         LIST_FOREACH(lmp, &sp->ep->marks, q)
                 if (lmp->name != ABSMARK1 &&
                     lmp->lno >= fl && lmp->lno <= tl) {
@@ -143,10 +143,7 @@ ex_move(SCR *sp, EXCMD *cmdp)
                         if (db_append(sp, 1, tl, bp, len))
                                 return (1);
                         if (mark_reset)
-                                LIST_FOREACH(lmp, &sp->ep->marks, q)
-                                        if (lmp->name != ABSMARK1 &&
-                                            lmp->lno == fl)
-                                                lmp->lno = tl + 1;
+                                mark_moveline(sp, fl, tl + 1);
                         if (db_delete(sp, fl))
                                 return (1);
                 }
@@ -161,10 +158,7 @@ ex_move(SCR *sp, EXCMD *cmdp)
                         if (db_append(sp, 1, tl++, bp, len))
                                 return (1);
                         if (mark_reset)
-                                LIST_FOREACH(lmp, &sp->ep->marks, q)
-                                        if (lmp->name != ABSMARK1 &&
-                                            lmp->lno == fl)
-                                                lmp->lno = tl;
+                                mark_moveline(sp, fl, tl);
                         ++fl;
                         if (db_delete(sp, fl))
                                 return (1);
@@ -176,11 +170,13 @@ ex_move(SCR *sp, EXCMD *cmdp)
         sp->cno = 0;
 
         /* Log the new positions of the marks. */
-        if (mark_reset)
+        if (mark_reset) {
+                mark_flush(sp);
                 LIST_FOREACH(lmp, &sp->ep->marks, q)
                         if (lmp->name != ABSMARK1 &&
                             lmp->lno >= mfl && lmp->lno <= mtl)
                                 (void)log_mark(sp, lmp);
+        }
 
         sp->rptlines[L_MOVED] += diff;
         return (0);
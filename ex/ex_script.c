@@ -372,76 +372,6 @@ err1:                       rval = 1;
         return (rval);
 }
 
-/*
- * sscr_check_input -
- *      Check for input from command input or scripting windows.
- *
- * PUBLIC: int sscr_check_input(SCR *sp);
- */
-int
-sscr_check_input(SCR *sp)
-{
-        GS *gp;
-        SCR *tsp;
-        struct pollfd *pfd;
-        int nfds, rval;
-
-        gp = sp->gp;
-        rval = 0;
-
-        /* Allocate space for pfd. */
-        nfds = 1;
-        TAILQ_FOREACH(tsp, &gp->dq, q)
-                if (F_ISSET(sp, SC_SCRIPT))
-                        nfds++;
-        pfd = calloc(nfds, sizeof(struct pollfd));
-        if (pfd == NULL) {
-                msgq(sp, M_SYSERR, "malloc");
-                return (1);
-        }
-
-        /* Setup events bitmasks. */
-        pfd[0].fd = STDIN_FILENO;
-        pfd[0].events = POLLIN;
-        nfds = 1;
-        TAILQ_FOREACH(tsp, &gp->dq, q)
-                if (F_ISSET(sp, SC_SCRIPT)) {
-                        pfd[nfds].fd = sp->script->sh_master;
-                        pfd[nfds].events = POLLIN;
-                        nfds++;
-                }
-
-loop:
-        /* Check for input. */
-        switch (poll(pfd, nfds, INFTIM)) {
-        case -1:
-                msgq(sp, M_SYSERR, "poll");
-                rval = 1;
-                /* FALLTHROUGH */
-        case 0:
-                goto done;
-        default:
-                break;
-        }
-
-        /* Only insert from the scripting windows if no command input */
-        if (!(pfd[0].revents & POLLIN)) {
-                nfds = 1;
-                TAILQ_FOREACH(tsp, &gp->dq, q)
-                        if (F_ISSET(sp, SC_SCRIPT)) {
-                                if ((pfd[nfds].revents & POLLHUP) && sscr_end(sp))
-                                        goto done;
-                                if ((pfd[nfds].revents & POLLIN) && sscr_insert(sp))
-                                        goto done;
-                                nfds++;
-                        }
-                goto loop;
-        }
-done:
-        free(pfd);
-        return (rval);
-}
-
 /*
  * sscr_input --
  *      Read any waiting shell input.
@@ -452,16 +382,17 @@ int
 sscr_input(SCR *sp)
 {
         GS *gp;
+        SCR *tsp;
         struct pollfd *pfd;
-        int nfds, rval;
+        int nfds, revents, rval;
 
         gp = sp->gp;
         rval = 0;
 
         /* Allocate space for pfd. */
         nfds = 0;
-        TAILQ_FOREACH(sp, &gp->dq, q)
-                if (F_ISSET(sp, SC_SCRIPT))
+        TAILQ_FOREACH(tsp, &gp->dq, q)
+                if (F_ISSET(tsp, SC_SCRIPT))
                         nfds++;
         if (nfds == 0)
                 return (0);
@@ -471,16 +402,18 @@ sscr_input(SCR *sp)
                 return (1);
         }
 
-        /* Setup events bitmasks. */
+loop:
+        /* Setup events bitmasks, for the scripts that are still running. */
         nfds = 0;
-        TAILQ_FOREACH(sp, &gp->dq, q)
-                if (F_ISSET(sp, SC_SCRIPT)) {
-                        pfd[nfds].fd = sp->script->sh_master;
+        TAILQ_FOREACH(tsp, &gp->dq, q)
+                if (F_ISSET(tsp, SC_SCRIPT)) {
+                        pfd[nfds].fd = tsp->script->sh_master;
                         pfd[nfds].events = POLLIN;
                         nfds++;
                 }
+        if (nfds == 0)
+                goto done;
 
-loop:
         /* Check for input. */
         switch (poll(pfd, nfds, 0)) {
         case -1:
@@ -493,15 +426,21 @@ loop:
                 break;
         }
 
-        /* Read the input. */
+        /*
+         * Read the input.  End the script if the shell has gone away or
+         * its descriptor is unusable, which drops it from the next poll.
+         */
         nfds = 0;
-        TAILQ_FOREACH(sp, &gp->dq, q)
-                if (F_ISSET(sp, SC_SCRIPT)) {
-                        if ((pfd[nfds].revents & POLLHUP) && sscr_end(sp))
-                                goto done;
-                        if ((pfd[nfds].revents & POLLIN) && sscr_insert(sp))
+        TAILQ_FOREACH(tsp, &gp->dq, q)
+                if (F_ISSET(tsp, SC_SCRIPT)) {
+                        revents = pfd[nfds++].revents;
+                        if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                                if (sscr_end(tsp))
+                                        goto done;
+                                continue;
+                        }
+                        if ((revents & POLLIN) && sscr_insert(tsp))
                                 goto done;
-                        nfds++;
                 }
         goto loop;
 done:
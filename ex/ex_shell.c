@@ -108,6 +108,9 @@ ex_exec_proc(SCR *sp, EXCMD *cmdp, char *cmd, const char *msg,
         }
         (void)ex_fflush(sp);
 
+        /* The utility shares the terminal, get our output out first. */
+        (void)gp->scr_refresh(sp, 0);
+
 #if defined(__APPLE__) && defined(__MACH__)
         switch (pid = fork()) {
 #else
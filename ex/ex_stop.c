@@ -38,6 +38,9 @@ ex_stop(SCR *sp, EXCMD *cmdp)
         if (!FL_ISSET(cmdp->iflags, E_C_FORCE) && file_aw(sp, FS_ALL))
                 return (1);
 
+        /* Don't leave changes unrecoverable while we're stopped. */
+        rcv_flush(sp);
+
         if (sp->gp->scr_suspend(sp, &allowed))
                 return (1);
         if (!allowed)
@@ -39,10 +39,25 @@
 
 static char     *binary_search(char *, char *, char *);
 static int       compare(char *, char *, char *);
-static void      ctag_file(SCR *, TAGF *, char *, char **, size_t *);
-static int       ctag_search(SCR *, char *, size_t, char *);
+static recno_t   ctag_fields(char *, char *, size_t *);
+static void      ctag_file(SCR *, TAGF *, char *, size_t, char **, size_t *);
+static int       ctag_find(SCR *, MARK *, char *, size_t, recno_t);
+static int       ctag_grams(TAGF *);
+static u_int32_t ctag_hash(const char *, size_t);
+static u_int32_t ctag_ilookup(TAGF *, char *);
+static int       ctag_index(TAGF *);
+static int       ctag_map(TAGF *);
+static int       ctag_memstr(const char *, size_t, const char *, size_t);
+static int       ctag_names(TAGF *);
+static int       ctag_pcompare(char *, size_t, char *, char *);
+static int       ctag_prefix(SCR *, EXCMD *, TAGF *, char *, size_t);
+static int       ctag_search(SCR *, char *, size_t, recno_t, char *);
 static int       ctag_sfile(SCR *, TAGF *, TAGQ *, char *);
 static TAGQ     *ctag_slist(SCR *, char *);
+static int       ctag_sorted(TAGF *);
+static int       ctag_substr(SCR *, EXCMD *, TAGF *, char *, size_t);
+static size_t    ctag_tlen(const char *, const char *);
+static void      ctag_unmap(TAGF *);
 static char     *linear_search(char *, char *, char *);
 static int       tag_copy(SCR *, TAG *, TAG **);
 static int       tag_pop(SCR *, TAGQ *, int);
@@ -185,8 +200,8 @@ ex_tag_push(SCR *sp, EXCMD *cmdp)
         /* Link the new TAGQ structure into place. */
         TAILQ_INSERT_HEAD(&exp->tq, tqp, q);
 
-        (void)ctag_search(sp,
-            tqp->current->search, tqp->current->slen, tqp->tag);
+        (void)ctag_search(sp, tqp->current->search,
+            tqp->current->slen, tqp->current->slno, tqp->tag);
 
         /*
          * Move the current context from the temporary save area into the
@@ -242,7 +257,7 @@ ex_tag_next(SCR *sp, EXCMD *cmdp)
                 return (1);
         tqp->current = tp;
 
-        (void)ctag_search(sp, tp->search, tp->slen, tqp->tag);
+        (void)ctag_search(sp, tp->search, tp->slen, tp->slno, tqp->tag);
 
         return (0);
 }
@@ -273,7 +288,7 @@ ex_tag_prev(SCR *sp, EXCMD *cmdp)
                 return (1);
         tqp->current = tp;
 
-        (void)ctag_search(sp, tp->search, tp->slen, tqp->tag);
+        (void)ctag_search(sp, tp->search, tp->slen, tp->slno, tqp->tag);
 
         return (0);
 }
@@ -664,6 +679,11 @@ tagf_copy(SCR *sp, TAGF *otfp, TAGF **tfpp)
         MALLOC_RET(sp, tfp, sizeof(TAGF));
         *tfp = *otfp;
 
+        /* The copy maps the file itself, if it's used. */
+        tfp->map = NULL;
+        tfp->idx = tfp->next = NULL;
+        tfp->names = tfp->gram = tfp->post = NULL;
+
         /* XXX: Allocate as part of the TAGF structure!!! */
         if ((tfp->name = strdup(otfp->name)) == NULL) {
                 free(tfp);
@@ -737,6 +757,7 @@ tagf_free(SCR *sp, TAGF *tfp)
 
         exp = EXP(sp);
         TAILQ_REMOVE(&exp->tagfq, tfp, q);
+        ctag_unmap(tfp);
         free(tfp->name);
         free(tfp);
         return (0);
@@ -823,7 +844,7 @@ ex_tagf_alloc(SCR *sp, char *str)
         for (p = t = str;; ++p) {
                 if (*p == '\0' || isblank(*p)) {
                         if ((len = p - t) > 1) {
-                                MALLOC_RET(sp, tfp, sizeof(TAGF));
+                                CALLOC_RET(sp, tfp, 1, sizeof(TAGF));
                                 MALLOC(sp, tfp->name, len + 1);
                                 if (tfp->name == NULL) {
                                         free(tfp);
@@ -831,7 +852,6 @@ ex_tagf_alloc(SCR *sp, char *str)
                                 }
                                 memcpy(tfp->name, t, len);
                                 tfp->name[len] = '\0';
-                                tfp->flags = 0;
                                 TAILQ_INSERT_TAIL(&exp->tagfq, tfp, q);
                         }
                         t = p + 1;
@@ -841,6 +861,39 @@ ex_tagf_alloc(SCR *sp, char *str)
         }
         return (0);
 }
+
+/*
+ * ex_tag_complete --
+ *      Append the names of the tags starting with a string to the argument
+ *      list, sorted, or of those containing it if it starts with a '*'.
+ *      Short strings would match most of a large tags file, so a prefix
+ *      has to be at least a character long, and a substring a trigram.
+ *
+ * PUBLIC: int ex_tag_complete(SCR *, EXCMD *, char *, size_t);
+ */
+int
+ex_tag_complete(SCR *sp, EXCMD *cmdp, char *str, size_t len)
+{
+        EX_PRIVATE *exp;
+        TAGF *tfp;
+        int off;
+
+        exp = EXP(sp);
+        off = exp->argsoff;
+        if (len == 0 || (str[0] == '*' && len < 4))
+                return (0);
+
+        /* Files that can't be read are reported by the tag command. */
+        TAILQ_FOREACH(tfp, &exp->tagfq, q) {
+                if (ctag_map(tfp) || tfp->map == NULL)
+                        continue;
+                if (len != 0 && str[0] == '*' ?
+                    ctag_substr(sp, cmdp, tfp, str + 1, len - 1) :
+                    ctag_prefix(sp, cmdp, tfp, str, len))
+                        return (1);
+        }
+        return (argv_uniq(sp, cmdp, off));
+}
                                                 /* Free previous queue. */
 /*
  * ex_tag_free --
@@ -870,7 +923,7 @@ ex_tag_free(SCR *sp)
  *      Search a file for a tag.
  */
 static int
-ctag_search(SCR *sp, char *search, size_t slen, char *tag)
+ctag_search(SCR *sp, char *search, size_t slen, recno_t slno, char *tag)
 {
         MARK m;
         char *p;
@@ -892,14 +945,10 @@ ctag_search(SCR *sp, char *search, size_t slen, char *tag)
                  * Search for the tag; cheap fallback for C functions
                  * if the name is the same but the arguments have changed.
                  */
-                m.lno = 1;
-                m.cno = 0;
-                if (f_search(sp, &m, &m,
-                    search, slen, NULL, SEARCH_FILE | SEARCH_TAG)) {
+                if (ctag_find(sp, &m, search, slen, slno)) {
                         if ((p = strrchr(search, '(')) != NULL) {
                                 slen = p - search;
-                                if (f_search(sp, &m, &m, search, slen,
-                                    NULL, SEARCH_FILE | SEARCH_TAG))
+                                if (ctag_find(sp, &m, search, slen, slno))
                                         goto notfound;
                         } else {
 notfound:                       tag_msg(sp, TAG_SEARCH, tag);
@@ -925,6 +974,25 @@ notfound:                       tag_msg(sp, TAG_SEARCH, tag);
         return (0);
 }
 
+/*
+ * ctag_find --
+ *      Find a tag's search pattern in the file.  If the tags file said
+ *      what line the tag was on, search outward from that line, the tag
+ *      is usually there or nearby even if the file has since changed.
+ */
+static int
+ctag_find(SCR *sp, MARK *mp, char *search, size_t slen, recno_t slno)
+{
+        mp->cno = 0;
+        if (slno != 0 && db_exist(sp, slno)) {
+                mp->lno = slno;
+                return (o_search(sp, mp, mp, search, slen, SEARCH_TAG));
+        }
+        mp->lno = 1;
+        return (f_search(sp, mp, mp,
+            search, slen, NULL, SEARCH_FILE | SEARCH_TAG));
+}
+
 /*
  * ctag_slist --
  *      Search the list of tags files for a tag, and return tag queue.
@@ -988,39 +1056,48 @@ alloc_err:
 static int
 ctag_sfile(SCR *sp, TAGF *tfp, TAGQ *tqp, char *tname)
 {
-        struct stat sb;
         TAG *tp;
-        size_t dlen, nlen, slen;
-        int fd, i, nf1, nf2;
-        char *back, *cname, *dname, *front, *map, *name, *p, *search, *t;
+        recno_t slno;
+        size_t clen, dlen, nlen, slen, tlen;
+        u_int32_t run;
+        int nf1, nf2;
+        char *back, *cname, *dname, *eol, *front, *name, *p, *search, *t;
 
-        if ((fd = open(tfp->name, O_RDONLY)) < 0) {
-                tfp->errnum = errno;
+        if (ctag_map(tfp))
                 return (1);
-        }
+        if (tfp->map == NULL)
+                return (0);
 
         /*
-         * XXX
-         * We'd like to test if the file is too big to mmap.  Since we don't
-         * know what size or type off_t's or size_t's are, what the largest
-         * unsigned integral type is, or what random insanity the local C
-         * compiler will perpetrate, doing the comparison in a portable way
-         * is flatly impossible.  Hope mmap fails if the file is too large.
+         * Binary search sorted files, it only touches a few pages of the
+         * mapping.  Unsorted files are looked up in a hash index, built on
+         * first use.
+         *
+         * Historic tags files don't say if they're sorted, and a binary
+         * search of an unsorted file misses tags that are there.  The
+         * first time a search of one of them fails, check the order of
+         * the whole file, and if it isn't sorted, use the index instead.
+         * The index chains together every run of lines for the tag.
          */
-        if (fstat(fd, &sb) != 0 ||
-            (map = mmap(NULL, (size_t)sb.st_size, PROT_READ | PROT_WRITE,
-            MAP_PRIVATE, fd, (off_t)0)) == MAP_FAILED) {
-                tfp->errnum = errno;
-                (void)close(fd);
-                return (1);
+        run = 0;
+        front = tfp->map;
+        back = front + tfp->mlen;
+        if (!F_ISSET(tfp, TAGF_UNSORTED)) {
+                front = binary_search(tname, front, back);
+                front = linear_search(tname, front, back);
+                if (front == NULL &&
+                    !F_ISSET(tfp, TAGF_CHECKED | TAGF_SORTED)) {
+                        F_SET(tfp, TAGF_CHECKED);
+                        if (!ctag_sorted(tfp))
+                                F_SET(tfp, TAGF_UNSORTED);
+                }
         }
-
-        front = map;
-        back = front + sb.st_size;
-        front = binary_search(tname, front, back);
-        front = linear_search(tname, front, back);
+        if (F_ISSET(tfp, TAGF_UNSORTED) &&
+            (tfp->idx != NULL || !ctag_index(tfp)))
+                front = (run = ctag_ilookup(tfp, tname)) == 0 ?
+                    NULL : tfp->map + tfp->names[run - 1];
         if (front == NULL)
-                goto done;
+                return (0);
 
         /*
          * Initialize and link in the tag structure(s).  The historic ctags
@@ -1036,40 +1113,29 @@ ctag_sfile(SCR *sp, TAGF *tfp, TAGQ *tqp, char *tname)
          *
          *      <tag> <filename> <line number> | <pattern>
          *
+         * optionally followed by the extended fields of ctags programs,
+         * which start with ;" and of which only line: is used.
+         *
          * Figure out how long everything is so we can allocate in one swell
-         * foop, but discard anything that looks wrong.
+         * foop, but discard anything that looks wrong.  The mapping is read
+         * only, so the fields are measured, not Nul-terminated.
          */
-        for (;;) {
-                /* Nul-terminate the end of the line. */
-                for (p = front; p < back && *p != '\n'; ++p);
-                if (p == back || *p != '\n')
+        for (tlen = strlen(tname);; front = eol + 1) {
+                /* Find the end of the line. */
+                if ((eol = memchr(front, '\n', back - front)) == NULL)
                         break;
-                *p = '\0';
-
-                /* Update the pointers for the next time. */
-                t = p + 1;
-                p = front;
-                front = t;
 
                 /* Break the line into tokens. */
-                for (i = 0; i < 2 && (t = strsep(&p, "\t ")) != NULL; ++i)
-                        switch (i) {
-                        case 0:                 /* Tag. */
-                                cname = t;
-                                break;
-                        case 1:                 /* Filename. */
-                                name = t;
-                                nlen = strlen(name);
-                                break;
-                        }
-
-                /* Check for corruption. */
-                if (i != 2 || p == NULL || t == NULL)
+                cname = front;
+                clen = ctag_tlen(cname, eol);
+                name = cname + clen + 1;
+                if (name > eol)
                         goto corrupt;
+                nlen = ctag_tlen(name, eol);
+                search = name + nlen + 1;
 
                 /* The rest of the string is the search pattern. */
-                search = p;
-                if ((slen = strlen(p)) == 0) {
+                if (search > eol || (slen = eol - search) == 0) {
 corrupt:                p = msg_print(sp, tname, &nf1);
                         t = msg_print(sp, tfp->name, &nf2);
                         msgq(sp, M_ERR, "%s: corrupted tag in %s", p, t);
@@ -1080,12 +1146,23 @@ corrupt:                p = msg_print(sp, tname, &nf1);
                         continue;
                 }
 
-                /* Check for passing the last entry. */
-                if (strcmp(tname, cname))
-                        break;
+                /*
+                 * Check for passing the last entry, or in an unsorted file,
+                 * move on to the tag's next run.  A later run never starts
+                 * the file, so the line before it ends with a newline.
+                 */
+                if (clen != tlen || memcmp(tname, cname, clen)) {
+                        if (run == 0 || (run = tfp->next[run - 1]) == 0)
+                                break;
+                        eol = tfp->map + tfp->names[run - 1] - 1;
+                        continue;
+                }
+
+                /* Split off any extended fields. */
+                slno = ctag_fields(search, eol, &slen);
 
                 /* Resolve the file name. */
-                ctag_file(sp, tfp, name, &dname, &dlen);
+                ctag_file(sp, tfp, name, nlen, &dname, &dlen);
 
                 CALLOC_GOTO(sp, tp,
                     1, sizeof(TAG) + dlen + 2 + nlen + 1 + slen + 1);
@@ -1095,30 +1172,485 @@ corrupt:                p = msg_print(sp, tname, &nf1);
                         tp->fname[dlen] = '/';
                         ++dlen;
                 }
-                memcpy(tp->fname + dlen, name, nlen + 1);
+                memcpy(tp->fname + dlen, name, nlen);
+                tp->fname[dlen + nlen] = '\0';
                 tp->fnlen = dlen + nlen;
+                tp->slno = slno;
                 tp->search = tp->fname + tp->fnlen + 1;
-                memcpy(tp->search, search, (tp->slen = slen) + 1);
+                memcpy(tp->search, search, tp->slen = slen);
+                tp->search[slen] = '\0';
                 TAILQ_INSERT_TAIL(&tqp->tagq, tp, q);
         }
 
 alloc_err:
-done:   if (munmap(map, (size_t)sb.st_size))
-                msgq(sp, M_SYSERR, "munmap");
-        if (close(fd))
-                msgq(sp, M_SYSERR, "close");
         return (0);
 }
 
+#define TAG_SORTED      "!_TAG_FILE_SORTED\t"
+#define TAG_SORTED_LEN  (sizeof(TAG_SORTED) - 1)
+
+/*
+ * ctag_map --
+ *      Map a tags file read-only, reusing the mapping from an earlier
+ *      search if the file hasn't changed.
+ */
+static int
+ctag_map(TAGF *tfp)
+{
+        struct stat sb;
+        char *back, *map, *p, *t;
+        int fd;
+
+        /*
+         * Checking a mapping costs a stat, so each tags file in the list
+         * adds little more than that and a binary search to a lookup.
+         */
+        if (stat(tfp->name, &sb) != 0) {
+                tfp->errnum = errno;
+                return (1);
+        }
+        if (tfp->map != NULL && tfp->mlen == (size_t)sb.st_size &&
+            tfp->mdev == sb.st_dev && tfp->minode == sb.st_ino &&
+            timespeccmp(&sb.st_mtim, &tfp->mtim, ==))
+                return (0);
+        ctag_unmap(tfp);
+
+        if ((fd = open(tfp->name, O_RDONLY)) < 0) {
+                tfp->errnum = errno;
+                return (1);
+        }
+        if (fstat(fd, &sb) != 0) {
+                tfp->errnum = errno;
+                (void)close(fd);
+                return (1);
+        }
+
+        /*
+         * XXX
+         * We'd like to test if the file is too big to mmap.  Since we don't
+         * know what size or type off_t's or size_t's are, what the largest
+         * unsigned integral type is, or what random insanity the local C
+         * compiler will perpetrate, doing the comparison in a portable way
+         * is flatly impossible.  Hope mmap fails if the file is too large.
+         *
+         * An empty file can't be mapped, and has no tags.
+         */
+        if (sb.st_size == 0) {
+                (void)close(fd);
+                return (0);
+        }
+        if ((map = mmap(NULL, (size_t)sb.st_size,
+            PROT_READ, MAP_PRIVATE, fd, (off_t)0)) == MAP_FAILED) {
+                tfp->errnum = errno;
+                (void)close(fd);
+                return (1);
+        }
+        (void)close(fd);
+
+        tfp->map = map;
+        tfp->mlen = sb.st_size;
+        tfp->mdev = sb.st_dev;
+        tfp->minode = sb.st_ino;
+        tfp->mtim = sb.st_mtim;
+
+        /*
+         * Exuberant and Universal ctags write "!_TAG_" header lines, which
+         * sort first.  One of them says if the file is sorted, 0 if not, 2
+         * if sorted ignoring case.  Historic files are always sorted.
+         */
+        F_CLR(tfp, TAGF_CHECKED | TAGF_SORTED | TAGF_UNSORTED);
+        for (p = map, back = map + tfp->mlen; back - p > TAG_SORTED_LEN &&
+            !memcmp(p, "!_TAG_", 6); p = t + 1) {
+                if (!memcmp(p, TAG_SORTED, TAG_SORTED_LEN))
+                        F_SET(tfp, p[TAG_SORTED_LEN] == '1' ?
+                            TAGF_SORTED : TAGF_UNSORTED);
+                if ((t = memchr(p, '\n', back - p)) == NULL)
+                        break;
+        }
+        return (0);
+}
+
+/*
+ * ctag_unmap --
+ *      Discard a tags file's mapping and index.
+ */
+static void
+ctag_unmap(TAGF *tfp)
+{
+        if (tfp->map != NULL)
+                (void)munmap(tfp->map, tfp->mlen);
+        tfp->map = NULL;
+        tfp->mlen = 0;
+        free(tfp->idx);
+        tfp->idx = NULL;
+        tfp->nidx = 0;
+        free(tfp->next);
+        tfp->next = NULL;
+        free(tfp->names);
+        tfp->names = NULL;
+        tfp->nnames = 0;
+        free(tfp->gram);
+        tfp->gram = NULL;
+        free(tfp->post);
+        tfp->post = NULL;
+}
+
+/*
+ * ctag_sorted --
+ *      Check that a mapped tags file is sorted, in the order compare()
+ *      expects.
+ */
+static int
+ctag_sorted(TAGF *tfp)
+{
+        size_t i, len, plen;
+        char *back, *p, *prev;
+
+        back = tfp->map + tfp->mlen;
+        for (prev = NULL, plen = 0, p = tfp->map; p != NULL && p < back;) {
+                len = ctag_tlen(p, back);
+                if (prev != NULL) {
+                        for (i = 0; i < len && i < plen && prev[i] == p[i]; ++i);
+                        if (i < len && i < plen ? prev[i] > p[i] : plen > len)
+                                return (0);
+                }
+                prev = p;
+                plen = len;
+                if ((p = memchr(p, '\n', back - p)) != NULL)
+                        ++p;
+        }
+        return (1);
+}
+
+/*
+ * ctag_index --
+ *      Build a hash index of a mapped tags file, from each tag name to the
+ *      first run of lines for it, and from each run to the tag's next one.
+ *      The offsets are 32 bits, so larger files are binary searched instead.
+ */
+static int
+ctag_index(TAGF *tfp)
+{
+        u_int32_t *lines;
+        size_t len, m, n, nlines, slot;
+        char *back, *front, *prev;
+
+        if (tfp->names == NULL && ctag_names(tfp))
+                return (1);
+        lines = tfp->names;
+        nlines = tfp->nnames;
+        back = tfp->map + tfp->mlen;
+
+        /* Keep the table at most half full. */
+        for (n = 16; n < nlines * 2; n <<= 1);
+        if ((tfp->idx = calloc(n, sizeof(u_int32_t))) == NULL)
+                return (1);
+        if ((tfp->next = calloc(nlines + 1, sizeof(u_int32_t))) == NULL) {
+                free(tfp->idx);
+                tfp->idx = NULL;
+                return (1);
+        }
+        tfp->nidx = n;
+
+        /*
+         * A tag can be repeated later in an unsorted file.  Add the runs
+         * last to first, each in front of the tag's chain, so the chain
+         * is in file order.
+         */
+        for (m = nlines; m-- > 0;) {
+                front = tfp->map + lines[m];
+                len = ctag_tlen(front, back);
+                for (slot = ctag_hash(front, len) & (n - 1);
+                    tfp->idx[slot] != 0; slot = (slot + 1) & (n - 1)) {
+                        prev = tfp->map + lines[tfp->idx[slot] - 1];
+                        if (ctag_tlen(prev, back) == len &&
+                            !memcmp(prev, front, len))
+                                break;
+                }
+                tfp->next[m] = tfp->idx[slot];
+                tfp->idx[slot] = m + 1;
+        }
+        return (0);
+}
+
+/*
+ * ctag_names --
+ *      Collect the first line of each run of lines with the same tag.
+ */
+static int
+ctag_names(TAGF *tfp)
+{
+        u_int32_t *p;
+        size_t len, m, n, plen;
+        char *back, *front, *prev;
+
+        if (tfp->mlen >= UINT32_MAX)
+                return (1);
+
+        back = tfp->map + tfp->mlen;
+        m = n = plen = 0;
+        for (prev = NULL, front = tfp->map; front != NULL && front < back;) {
+                len = ctag_tlen(front, back);
+                if (prev == NULL || len != plen || memcmp(prev, front, len)) {
+                        if (n == m) {
+                                m = m == 0 ? 1024 : m * 2;
+                                if ((p = reallocarray(tfp->names,
+                                    m, sizeof(u_int32_t))) == NULL) {
+                                        free(tfp->names);
+                                        tfp->names = NULL;
+                                        return (1);
+                                }
+                                tfp->names = p;
+                        }
+                        tfp->names[n++] = front - tfp->map;
+                }
+                prev = front;
+                plen = len;
+                if ((front = memchr(front, '\n', back - front)) != NULL)
+                        ++front;
+        }
+        if (n == 0 && (tfp->names = malloc(sizeof(u_int32_t))) == NULL)
+                return (1);
+        tfp->nnames = n;
+        return (0);
+}
+
+/*
+ * Tag names are indexed for substring queries by their trigrams, hashed
+ * into TAG_NGRAMS lists of the names containing them.  A query only has
+ * to check the names on the shortest list of any of its trigrams.
+ */
+#define TAG_NGRAMS      65536
+#define TAG_GRAM(p)                                                     \
+        ((((u_int32_t)(u_char)(p)[0] << 16 |                            \
+        (u_int32_t)(u_char)(p)[1] << 8 | (u_char)(p)[2]) * 2654435761U) >> 16)
+
+/*
+ * ctag_grams --
+ *      Build the trigram index of a tags file's names.
+ */
+static int
+ctag_grams(TAGF *tfp)
+{
+        u_int32_t *cur, g, n, total;
+        size_t i, len;
+        char *back, *p;
+
+        if (tfp->names == NULL && ctag_names(tfp))
+                return (1);
+        if ((tfp->gram = calloc(TAG_NGRAMS + 1, sizeof(u_int32_t))) == NULL)
+                return (1);
+        if ((cur = calloc(TAG_NGRAMS, sizeof(u_int32_t))) == NULL)
+                goto err;
+
+        /* Count the names on each list, once per name. */
+        back = tfp->map + tfp->mlen;
+        for (n = 0; n < tfp->nnames; ++n) {
+                p = tfp->map + tfp->names[n];
+                len = ctag_tlen(p, back);
+                for (i = 0; i + 3 <= len; ++i) {
+                        g = TAG_GRAM(p + i);
+                        if (cur[g] != n + 1) {
+                                cur[g] = n + 1;
+                                ++tfp->gram[g];
+                        }
+                }
+        }
+        for (total = 0, g = 0; g < TAG_NGRAMS; ++g) {
+                n = tfp->gram[g];
+                cur[g] = tfp->gram[g] = total;
+                total += n;
+        }
+        tfp->gram[TAG_NGRAMS] = total;
+
+        /* Fill them in, in name order. */
+        if ((tfp->post = reallocarray(NULL,
+            total == 0 ? 1 : total, sizeof(u_int32_t))) == NULL)
+                goto err;
+        for (n = 0; n < tfp->nnames; ++n) {
+                p = tfp->map + tfp->names[n];
+                len = ctag_tlen(p, back);
+                for (i = 0; i + 3 <= len; ++i) {
+                        g = TAG_GRAM(p + i);
+                        if (cur[g] == tfp->gram[g] ||
+                            tfp->post[cur[g] - 1] != n)
+                                tfp->post[cur[g]++] = n;
+                }
+        }
+        free(cur);
+        return (0);
+
+err:    free(cur);
+        free(tfp->gram);
+        tfp->gram = NULL;
+        return (1);
+}
+
+/*
+ * ctag_substr --
+ *      Add the names in a tags file that contain a string.
+ */
+static int
+ctag_substr(SCR *sp, EXCMD *cmdp, TAGF *tfp, char *str, size_t len)
+{
+        u_int32_t *end, *n, *post;
+        size_t i, nlen;
+        char *back, *p;
+
+        if (tfp->names == NULL && ctag_names(tfp))
+                return (0);
+        back = tfp->map + tfp->mlen;
+
+        /* If the index can't be built, check every name. */
+        if (tfp->gram == NULL && ctag_grams(tfp)) {
+                for (i = 0; i < tfp->nnames; ++i) {
+                        p = tfp->map + tfp->names[i];
+                        nlen = ctag_tlen(p, back);
+                        if (ctag_memstr(p, nlen, str, len) &&
+                            (nlen < 2 || p[0] != '!' || p[1] != '_') &&
+                            argv_exp0(sp, cmdp, p, nlen))
+                                return (1);
+                }
+                return (0);
+        }
+
+        /* Check the names on the shortest list. */
+        post = tfp->post + tfp->gram[TAG_GRAM(str)];
+        end = tfp->post + tfp->gram[TAG_GRAM(str) + 1];
+        for (i = 1; i + 3 <= len; ++i)
+                if (tfp->gram[TAG_GRAM(str + i) + 1] -
+                    tfp->gram[TAG_GRAM(str + i)] < (size_t)(end - post)) {
+                        post = tfp->post + tfp->gram[TAG_GRAM(str + i)];
+                        end = tfp->post + tfp->gram[TAG_GRAM(str + i) + 1];
+                }
+        for (n = post; n < end; ++n) {
+                p = tfp->map + tfp->names[*n];
+                nlen = ctag_tlen(p, back);
+                if (ctag_memstr(p, nlen, str, len) &&
+                    (nlen < 2 || p[0] != '!' || p[1] != '_') &&
+                    argv_exp0(sp, cmdp, p, nlen))
+                        return (1);
+        }
+        return (0);
+}
+
+/*
+ * ctag_memstr --
+ *      Return if a string is found in a length delimited one.
+ */
+static int
+ctag_memstr(const char *p, size_t plen, const char *s, size_t len)
+{
+        for (; plen >= len; ++p, --plen)
+                if (len == 0 || (*p == *s && !memcmp(p, s, len)))
+                        return (1);
+        return (0);
+}
+
+/*
+ * ctag_ilookup --
+ *      Find the first run of lines for a tag in a tags file's hash index,
+ *      returning its name number + 1, or 0 if there's none.
+ */
+static u_int32_t
+ctag_ilookup(TAGF *tfp, char *tname)
+{
+        size_t len, slot;
+        char *back, *p;
+
+        back = tfp->map + tfp->mlen;
+        len = strlen(tname);
+        for (slot = ctag_hash(tname, len) & (tfp->nidx - 1);
+            tfp->idx[slot] != 0; slot = (slot + 1) & (tfp->nidx - 1)) {
+                p = tfp->map + tfp->names[tfp->idx[slot] - 1];
+                if (ctag_tlen(p, back) == len && !memcmp(p, tname, len))
+                        return (tfp->idx[slot]);
+        }
+        return (0);
+}
+
+/*
+ * ctag_hash --
+ *      Hash a tag name (FNV-1a).
+ */
+static u_int32_t
+ctag_hash(const char *p, size_t len)
+{
+        u_int32_t h;
+
+        for (h = 2166136261U; len > 0; ++p, --len)
+                h = (h ^ (u_char)*p) * 16777619U;
+        return (h);
+}
+
+/*
+ * ctag_tlen --
+ *      Return the length of the tags file field at p.
+ *
+ * !!!
+ * Reasonably modern ctags programs use tabs as separators, not spaces.
+ * However, historic programs did use spaces, and, I got complaints.
+ */
+static size_t
+ctag_tlen(const char *p, const char *back)
+{
+        const char *t;
+
+        for (t = p; t < back && *t != '\t' && *t != ' ' && *t != '\n'; ++t);
+        return (t - p);
+}
+
+/*
+ * ctag_fields --
+ *      Trim the extended fields from a tag's address, and return the
+ *      line number from any line: field, or 0.
+ *
+ *      <address>;"<tab><kind><tab>line:<number><tab>...
+ */
+static recno_t
+ctag_fields(char *search, char *eol, size_t *slenp)
+{
+        recno_t lno;
+        char *p, *t;
+        int delim;
+
+        /* Find the end of the address, a pattern or a line number. */
+        p = search;
+        if (*p == '/' || *p == '?') {
+                for (delim = *p++; p < eol && *p != delim; ++p)
+                        if (*p == '\\' && p + 1 < eol)
+                                ++p;
+                if (p < eol)
+                        ++p;
+        } else
+                while (p < eol && isdigit(*p))
+                        ++p;
+        if (eol - p < 2 || p[0] != ';' || p[1] != '"')
+                return (0);
+        *slenp = p - search;
+
+        for (lno = 0, p += 2; p < eol; p = t) {
+                if ((t = memchr(p, '\t', eol - p)) == NULL)
+                        t = eol;
+                if (t - p > 5 && !memcmp(p, "line:", 5))
+                        for (lno = 0, p += 5; p < t && isdigit(*p); ++p)
+                                lno = lno * 10 + (*p - '0');
+                if (t < eol)
+                        ++t;
+        }
+        return (lno);
+}
+
 /*
  * ctag_file --
  *      Search for the right path to this file.
  */
 static void
-ctag_file(SCR *sp, TAGF *tfp, char *name, char **dirp, size_t *dlenp)
+ctag_file(SCR *sp, TAGF *tfp, char *name, size_t nlen, char **dirp,
+    size_t *dlenp)
 {
         struct stat sb;
-        char *p, buf[PATH_MAX];
+        char *p, buf[PATH_MAX], nbuf[PATH_MAX];
 
         /*
          * !!!
@@ -1129,11 +1661,16 @@ ctag_file(SCR *sp, TAGF *tfp, char *name, char **dirp, size_t *dlenp)
          * pretty clear what's happening, so we may as well get it right.
          */
         *dlenp = 0;
-        if (name[0] != '/' &&
-            stat(name, &sb) && (p = strrchr(tfp->name, '/')) != NULL) {
+        if (nlen >= sizeof(nbuf))
+                return;
+        memcpy(nbuf, name, nlen);
+        nbuf[nlen] = '\0';
+        if (nbuf[0] != '/' &&
+            stat(nbuf, &sb) && (p = strrchr(tfp->name, '/')) != NULL) {
                 *p = '\0';
-                (void)snprintf(buf, sizeof(buf), "%s/%s", tfp->name, name);
-                if (stat(buf, &sb) == 0) {
+                if ((size_t)snprintf(buf, sizeof(buf),
+                    "%s/%s", tfp->name, nbuf) < sizeof(buf) &&
+                    stat(buf, &sb) == 0) {
                         *dirp = tfp->name;
                         *dlenp = strlen(*dirp);
                 }
@@ -1255,3 +1792,91 @@ compare(char *s1, char *s2, char *back)
         return (*s1 ? GREATER : s2 < back &&
             (*s2 != '\t' && *s2 != ' ') ? LESS : EQUAL);
 }
+
+/*
+ * Return LESS, GREATER, or EQUAL depending on how the string s1, of length
+ * len, compares with the start of the tag s2.  Tags that s1 is a prefix of
+ * are EQUAL.
+ */
+static int
+ctag_pcompare(char *s1, size_t len, char *s2, char *back)
+{
+        for (; len > 0; ++s1, ++s2, --len) {
+                if (s2 >= back || *s2 == '\t' || *s2 == ' ' || *s2 == '\n')
+                        return (GREATER);
+                if (*s1 != *s2)
+                        return (*s1 < *s2 ? LESS : GREATER);
+        }
+        return (EQUAL);
+}
+
+/*
+ * ctag_prefix --
+ *      Add the names in a tags file that start with a string.
+ */
+static int
+ctag_prefix(SCR *sp, EXCMD *cmdp, TAGF *tfp, char *str, size_t len)
+{
+        EX_PRIVATE *exp;
+        size_t i, nlen, plen;
+        int cmp, off;
+        char *back, *end, *front, *p, *prev;
+
+        exp = EXP(sp);
+        back = end = tfp->map + tfp->mlen;
+
+        /*
+         * Binary search for the start of the range of tags with the prefix,
+         * and read them up to its end.  As in ctag_sfile(), if that finds
+         * nothing in a file that doesn't say it's sorted, check its order,
+         * and check every name if it isn't.
+         */
+        if (!F_ISSET(tfp, TAGF_UNSORTED)) {
+                off = exp->argsoff;
+                front = tfp->map;
+                p = front + (back - front) / 2;
+                SKIP_PAST_NEWLINE(p, back);
+                while (p != back) {
+                        if (ctag_pcompare(str, len, p, back) == GREATER)
+                                front = p;
+                        else
+                                back = p;
+                        p = front + (back - front) / 2;
+                        SKIP_PAST_NEWLINE(p, back);
+                }
+                for (prev = NULL, plen = 0; front < end;) {
+                        cmp = ctag_pcompare(str, len, front, end);
+                        if (cmp == LESS)
+                                break;
+                        nlen = ctag_tlen(front, end);
+                        if (cmp == EQUAL &&
+                            (nlen != plen || memcmp(prev, front, nlen)) &&
+                            (nlen < 2 || front[0] != '!' || front[1] != '_')) {
+                                if (argv_exp0(sp, cmdp, front, nlen))
+                                        return (1);
+                                prev = front;
+                                plen = nlen;
+                        }
+                        SKIP_PAST_NEWLINE(front, end);
+                }
+                if (exp->argsoff != off ||
+                    F_ISSET(tfp, TAGF_CHECKED | TAGF_SORTED))
+                        return (0);
+                F_SET(tfp, TAGF_CHECKED);
+                if (ctag_sorted(tfp))
+                        return (0);
+                F_SET(tfp, TAGF_UNSORTED);
+        }
+
+        if (tfp->names == NULL && ctag_names(tfp))
+                return (0);
+        for (i = 0; i < tfp->nnames; ++i) {
+                p = tfp->map + tfp->names[i];
+                nlen = ctag_tlen(p, end);
+                if (nlen >= len && !memcmp(p, str, len) &&
+                    (nlen < 2 || p[0] != '!' || p[1] != '_') &&
+                    argv_exp0(sp, cmdp, p, nlen))
+                        return (1);
+        }
+        return (0);
+}
@@ -251,7 +251,8 @@ notlast:                        TAILQ_REMOVE(tiqh, tp, q);
                                          * Put out a line separator, in case
                                          * the command fails.
                                          */
-                                        (void)putchar('\n');
+                                        (void)sp->gp->scr_addstr(sp,
+                                            "\n", 1);
                                         goto done;
                                 }
                         }
@@ -348,18 +349,28 @@ alloc_err:
 static void
 txt_prompt(SCR *sp, TEXT *tp, CHAR_T prompt, u_int32_t flags)
 {
+        GS *gp;
+        int len;
+        char buf[32];
+
+        gp = sp->gp;
+
         /* Display the prompt. */
-        if (LF_ISSET(TXT_PROMPT))
-                (void)printf("%c", prompt);
+        if (LF_ISSET(TXT_PROMPT)) {
+                buf[0] = prompt;
+                (void)gp->scr_addstr(sp, buf, 1);
+        }
 
         /* Display the line number. */
-        if (LF_ISSET(TXT_NUMBER) && O_ISSET(sp, O_NUMBER))
-                (void)printf("%6lu  ", (u_long)tp->lno);
+        if (LF_ISSET(TXT_NUMBER) && O_ISSET(sp, O_NUMBER)) {
+                len = snprintf(buf, sizeof(buf), "%6lu  ", (u_long)tp->lno);
+                if (len > 0 && len < sizeof(buf))
+                        (void)gp->scr_addstr(sp, buf, len);
+        }
 
         /* Print out autoindent string. */
         if (LF_ISSET(TXT_AUTOINDENT))
-                (void)printf("%.*s", (int)tp->ai, tp->lb);
-        (void)fflush(stdout);
+                (void)gp->scr_addstr(sp, tp->lb, tp->ai);
 }
 
 /*
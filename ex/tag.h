@@ -23,8 +23,29 @@ struct _tagf {                  /* Tag files. */
         char    *name;          /* Tag file name. */
         int      errnum;        /* Errno. */
 
+                                /* Cached read-only mapping. */
+        char    *map;           /* Mapped file, NULL if none. */
+        size_t   mlen;          /* Mapped length. */
+        dev_t    mdev;          /* Device of the mapped file. */
+        ino_t    minode;        /* Inode of the mapped file. */
+        struct timespec mtim;   /* Last modification time. */
+
+                                /* Tag name hash index. */
+        u_int32_t *idx;         /* Name numbers + 1, 0 if empty. */
+        size_t   nidx;          /* Slots, a power of 2. */
+        u_int32_t *next;        /* Next name number + 1 of the tag. */
+
+                                /* Tag name query indices. */
+        u_int32_t *names;       /* First line of each run of a tag. */
+        size_t   nnames;        /* Number of names. */
+        u_int32_t *gram;        /* Trigram starts in post, and end. */
+        u_int32_t *post;        /* Name numbers, by trigram. */
+
 #define TAGF_ERR        0x01    /* Error occurred. */
 #define TAGF_ERR_WARN   0x02    /* Error reported. */
+#define TAGF_CHECKED    0x04    /* Sort order checked. */
+#define TAGF_SORTED     0x08    /* File says it's sorted. */
+#define TAGF_UNSORTED   0x10    /* File isn't sorted. */
         u_int8_t flags;
 };
 
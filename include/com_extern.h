@@ -31,8 +31,10 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+int batch(SCR *, char *, char *[], int);
 int cut(SCR *, CHAR_T *, MARK *, MARK *, int);
 int cut_line(SCR *, recno_t, size_t, size_t, CB *);
+void cut_free(CB *);
 void cut_close(GS *);
 TEXT *text_init(SCR *, const char *, size_t, size_t);
 void text_lfree(TEXTH *);
@@ -57,10 +59,15 @@ int v_event_push(SCR *, EVENT *, CHAR_T *, size_t, u_int);
 int v_event_get(SCR *, EVENT *, int, u_int32_t);
 void v_event_err(SCR *, EVENT *);
 int v_event_flush(SCR *, u_int);
+void v_timer_set(SCR *, TIMER *, int);
+void v_timer_clr(SCR *, TIMER *);
+int v_timer_next(GS *);
+void v_timer_run(SCR *);
 int db_eget(SCR *, recno_t, char **, size_t *, int *);
 int db_get(SCR *, recno_t, u_int32_t, char **, size_t *);
 int db_delete(SCR *, recno_t);
 int db_append(SCR *, int, recno_t, char *, size_t);
+int db_appendv(SCR *, int, recno_t, CBLINE *, recno_t);
 int db_insert(SCR *, recno_t, char *, size_t);
 int db_set(SCR *, recno_t, char *, size_t);
 int db_exist(SCR *, recno_t);
@@ -70,17 +77,21 @@ int log_init(SCR *, EXF *);
 int log_end(SCR *, EXF *);
 int log_cursor(SCR *);
 int log_line(SCR *, recno_t, u_int);
+int log_lines(SCR *, recno_t, CBLINE *, recno_t);
 int log_mark(SCR *, LMARK *);
 int log_backward(SCR *, MARK *);
 int log_setline(SCR *);
 int log_forward(SCR *, MARK *);
+size_t log_size(SCR *);
 int editor(GS *, int, char *[]);
 void v_end(GS *);
 int mark_init(SCR *, EXF *);
 int mark_end(SCR *, EXF *);
 int mark_get(SCR *, CHAR_T, MARK *, mtype_t);
 int mark_set(SCR *, CHAR_T, MARK *, int);
-int mark_insdel(SCR *, lnop_t, recno_t);
+void mark_flush(SCR *);
+void mark_moveline(SCR *, recno_t, recno_t);
+int mark_insdel(SCR *, lnop_t, recno_t, recno_t);
 void msgq(SCR *, mtype_t, const char *, ...);
 void msgq_str(SCR *, mtype_t, char *, char *);
 void mod_rpt(SCR *);
@@ -116,6 +127,13 @@ int put(SCR *, CB *, CHAR_T *, MARK *, MARK *, int);
 int rcv_tmp(SCR *, EXF *, char *);
 int rcv_init(SCR *);
 int rcv_sync(SCR *, u_int);
+void rcv_later(SCR *);
+void rcv_flush(SCR *);
+int rcv_jstart(SCR *);
+void rcv_jnl(SCR *, lnop_t, recno_t, char *, size_t);
+void rcv_jend(EXF *, int);
+char *rcv_jopen(SCR *, EXF *, char **);
+int rcv_jreplay(SCR *, EXF *);
 int rcv_list(SCR *);
 int rcv_read(SCR *, FREF *);
 int screen_init(GS *, SCR *, SCR **);
@@ -123,11 +141,12 @@ int screen_end(SCR *);
 SCR *screen_next(SCR *);
 int f_search(SCR *, MARK *, MARK *, char *, size_t, char **, u_int);
 int b_search(SCR *, MARK *, MARK *, char *, size_t, char **, u_int);
+int o_search(SCR *, MARK *, MARK *, char *, size_t, u_int);
 void search_busy(SCR *, busy_t);
 int seq_set(SCR *, CHAR_T *,
 size_t, CHAR_T *, size_t, CHAR_T *, size_t, seq_t, int);
 int seq_delete(SCR *, CHAR_T *, size_t, seq_t);
-int seq_mdel(SEQ *);
+int seq_mdel(GS *, SEQ *);
 SEQ *seq_find
 (SCR *, SEQ **, EVENT *, CHAR_T *, size_t, seq_t, int *);
 void seq_close(GS *);
@@ -139,4 +158,5 @@ int nonblank(SCR *, recno_t, size_t *);
 CHAR_T *v_strdup(SCR *, const CHAR_T *, size_t);
 enum nresult nget_uslong(u_long *, const char *, char **, int);
 enum nresult nget_slong(long *, const char *, char **, int);
+int phash(PHTAB const *, const char *, size_t);
 void TRACE(SCR *, const char *, ...);
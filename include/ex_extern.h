@@ -36,6 +36,7 @@ int ex_cmd(SCR *);
 int ex_range(SCR *, EXCMD *, int *);
 int ex_is_abbrev(char *, size_t);
 int ex_is_unmap(char *, size_t);
+int ex_is_tag(char *, size_t);
 void ex_badaddr(SCR *, EXCMDLIST const *, enum badaddr, enum nresult);
 int ex_abbr(SCR *, EXCMD *);
 int ex_unabbr(SCR *, EXCMD *);
@@ -53,6 +54,7 @@ int argv_exp1(SCR *, EXCMD *, char *, size_t, int);
 int argv_exp2(SCR *, EXCMD *, char *, size_t);
 int argv_exp3(SCR *, EXCMD *, char *, size_t);
 int argv_free(SCR *);
+int argv_uniq(SCR *, EXCMD *, int);
 int ex_at(SCR *, EXCMD *);
 int ex_bang(SCR *, EXCMD *);
 int ex_cd(SCR *, EXCMD *);
@@ -64,7 +66,7 @@ int ex_file(SCR *, EXCMD *);
 int ex_filter(SCR *, EXCMD *, MARK *, MARK *, MARK *, char *, enum filtertype);
 int ex_global(SCR *, EXCMD *);
 int ex_v(SCR *, EXCMD *);
-int ex_g_insdel(SCR *, lnop_t, recno_t);
+int ex_g_insdel(SCR *, lnop_t, recno_t, recno_t);
 int ex_screen_copy(SCR *, SCR *);
 int ex_screen_end(SCR *);
 int ex_optchange(SCR *, int, char *, u_long *);
@@ -99,7 +101,6 @@ int ex_resize(SCR *, EXCMD *);
 int ex_sdisplay(SCR *);
 int ex_script(SCR *, EXCMD *);
 int sscr_exec(SCR *, recno_t);
-int sscr_check_input(SCR *);
 int sscr_input(SCR *);
 int sscr_end(SCR *);
 int ex_set(SCR *, EXCMD *);
@@ -129,6 +130,7 @@ int ex_tag_copy(SCR *, SCR *);
 int tagq_free(SCR *, TAGQ *);
 void tag_msg(SCR *, tagmsg_t, char *);
 int ex_tagf_alloc(SCR *, char *);
+int ex_tag_complete(SCR *, EXCMD *, char *, size_t);
 int ex_tag_free(SCR *);
 int ex_txt(SCR *, TEXTH *, CHAR_T, u_int32_t);
 int ex_undo(SCR *, EXCMD *);
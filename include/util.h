@@ -62,4 +62,26 @@ enum nresult { NUM_ERR, NUM_OK, NUM_OVER, NUM_UNDER };
             NPFITS(LONG_MAX, (v1), (v2)) ? NUM_OK : NUM_OVER :          \
          NUM_OK)
 
+/*
+ * Perfect hash tables, built by common/phash.awk and searched by phash().
+ * A key hashes to a bucket, and the bucket's displacement, times a second
+ * hash of the key, picks the key's slot.  Nothing else hashes to it.
+ */
+# define PH_MULT_BUCKET 31                /* Bucket hash multiplier. */
+# define PH_MULT_SLOT   37                /* Slot hash multiplier. */
+# define PH_MULT_STEP   41                /* Displacement hash multiplier. */
+
+typedef struct _phent {
+        const char *key;                  /* Key, NULL if slot is empty. */
+        size_t   len;                     /* Key length. */
+        int      val;                     /* Value. */
+} PHENT;
+
+typedef struct _phtab {
+        PHENT const *ent;                 /* Slots. */
+        u_int    nent;                    /* Slot count, a prime. */
+        u_int16_t const *disp;            /* Bucket displacements. */
+        u_int    nbucket;                 /* Bucket count. */
+} PHTAB;
+
 #endif /* ifndef _UTIL_H */
@@ -32,9 +32,9 @@ int
 v_at(SCR *sp, VICMD *vp)
 {
         CB *cbp;
+        CBLINE *tp;
         CHAR_T name;
-        TEXT *tp;
-        size_t len;
+        size_t cnt, len;
         char nbuf[20];
 
         /*
@@ -58,7 +58,7 @@ v_at(SCR *sp, VICMD *vp)
         F_SET(sp, SC_AT_SET);
 
         CBNAME(sp, cbp, name);
-        if (cbp == NULL) {
+        if (cbp == NULL || CB_NLINES(cbp) == 0) {
                 ex_emsg(sp, KEY_NAME(sp, name), EXM_EMPTYBUF);
                 return (1);
         }
@@ -82,11 +82,13 @@ v_at(SCR *sp, VICMD *vp)
          * together.  We don't get this right; I'm waiting for the new DB
          * logging code to be available.
          */
-        TAILQ_FOREACH_REVERSE(tp, &cbp->textq, _texth, q)
-                if (((F_ISSET(cbp, CB_LMODE) || TAILQ_NEXT(tp, q)) &&
+        for (cnt = CB_NLINES(cbp); cnt-- > 0;) {
+                tp = CB_LINE(cbp, cnt);
+                if (((F_ISSET(cbp, CB_LMODE) || cnt + 1 < CB_NLINES(cbp)) &&
                     v_event_push(sp, NULL, "\n", 1, 0)) ||
                     v_event_push(sp, NULL, tp->lb, tp->len, 0))
                         return (1);
+        }
 
         /*
          * !!!
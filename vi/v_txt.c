@@ -36,6 +36,7 @@ static int       txt_emark(SCR *, TEXT *, size_t);
 static void      txt_err(SCR *, TEXTH *);
 static int       txt_fc(SCR *, TEXT *, int *);
 static int       txt_fc_col(SCR *, int, ARGS **);
+static int       txt_fc_tag(TEXT *, char *);
 static int       txt_hex(SCR *, TEXT *);
 static int       txt_insch(SCR *, TEXT *, CHAR_T *, u_int);
 static int       txt_isrch(SCR *, VICMD *, TEXT *, u_int8_t *);
@@ -43,6 +44,7 @@ static int       txt_map_end(SCR *);
 static int       txt_map_init(SCR *);
 static int       txt_margin(SCR *, TEXT *, TEXT *, int *, u_int32_t);
 static void      txt_nomorech(SCR *);
+static int       txt_paste(SCR *, TEXT **, CHAR_T *, size_t, u_int32_t *);
 static void      txt_Rresolve(SCR *, TEXTH *, TEXT *, const size_t);
 static int       txt_resolve(SCR *, TEXTH *, u_int32_t);
 static int       txt_showmatch(SCR *, TEXT *);
@@ -255,6 +257,7 @@ v_txt(SCR *sp, VICMD *vp, MARK *tm, const char *lp, size_t len,
         size_t margin;          /* Wrapmargin value. */
         size_t rcol;            /* 0-N: insert offset in the replay buffer. */
         size_t tcol;            /* Temporary column. */
+        size_t blen, plen;      /* Replayed paste buffer length, paste length. */
         u_int32_t ec_flags;     /* Input mapping flags. */
 #define IS_RESTART      0x01    /* Reset the incremental search. */
 #define IS_RUNNING      0x02    /* Incremental search turned on. */
@@ -265,7 +268,8 @@ v_txt(SCR *sp, VICMD *vp, MARK *tm, const char *lp, size_t len,
         int showmatch;          /* Showmatch set on this character. */
         int wm_set, wm_skip;    /* Wrapmargin happened, blank skip flags. */
         int max, tmp;
-        char *p;
+        CHAR_T *cp;
+        char *bp, *p;
 
         gp = sp->gp;
         vip = VIP(sp);
@@ -451,8 +455,13 @@ newtp:          if ((tp = text_init(sp, lp, len, len + 32)) == NULL)
             LF_ISSET(TXT_SEARCHINCR) ? IS_RESTART | IS_RUNNING : 0);
         filec_redraw = hexcnt = showmatch = 0;
 
-        /* Initialize input flags. */
+        /*
+         * Initialize input flags.  Pastes are inserted whole, except on the
+         * colon command line and in script windows, where they're keys.
+         */
         ec_flags = LF_ISSET(TXT_MAPINPUT) ? EC_MAPINPUT : 0;
+        if (!LF_ISSET(TXT_CR))
+                FL_SET(ec_flags, EC_PASTE);
 
         /* Refresh the screen. */
         UPDATE_POSITION(sp, tp);
@@ -498,6 +507,43 @@ next:   if (v_event_get(sp, evp, 0, ec_flags))
                 if (vs_repaint(sp, &ev))
                         return (1);
                 goto next;
+        case E_PASTE:
+                /*
+                 * If the user is quoting a character, the paste is just more
+                 * keys.  Otherwise, insert the whole thing, literally, and
+                 * record it as characters flagged as a paste, so a replay
+                 * inserts it the same way.
+                 */
+                if (quote != Q_NOTSET || hexcnt != 0) {
+                        tmp = v_event_push(sp,
+                            NULL, evp->e_csp, evp->e_len, CH_NOMAP);
+                        free(evp->e_asp);
+                        if (tmp)
+                                goto err;
+                        goto next;
+                }
+                if (LF_ISSET(TXT_RECORD)) {
+                        BINC_GOTO(sp, vip->rep, vip->rep_len,
+                            (rcol + evp->e_len) * sizeof(EVENT));
+                        for (cp = evp->e_csp,
+                            tcol = evp->e_len; tcol--; ++cp, ++rcol) {
+                                vip->rep[rcol].e_event = E_CHARACTER;
+                                vip->rep[rcol].e_c = *cp;
+                                vip->rep[rcol].e_value = KEY_VAL(sp, *cp);
+                                vip->rep[rcol].e_flags = CH_PASTE;
+                        }
+                }
+                tmp = txt_paste(sp, &tp, evp->e_csp, evp->e_len, &flags);
+                free(evp->e_asp);
+                if (tmp)
+                        goto err;
+
+                /* What's entered next doesn't continue what preceded it. */
+                carat = C_NOTSET;
+                wm_skip = 0;
+                if (abb != AB_NOTSET)
+                        abb = AB_NOTWORD;
+                goto ebuf_chk;
         case E_WRESIZE:
                 /* <resize> interrupts the input mode. */
                 sp->gp->scr_imctrl(sp, IMCTRL_OFF);
@@ -604,9 +650,30 @@ next:   if (v_event_get(sp, evp, 0, ec_flags))
                 vip->rep[rcol++] = *evp;
         }
 
-replay: if (LF_ISSET(TXT_REPLAY))
+replay: if (LF_ISSET(TXT_REPLAY)) {
                 evp = vip->rep + rcol++;
 
+                /*
+                 * Replay a paste in a single piece.  The recorded input
+                 * always ends with an <escape>, so the paste is followed
+                 * by something that isn't part of it.
+                 */
+                if (F_ISSET(&evp->e_ch, CH_PASTE)) {
+                        for (tcol = rcol;
+                            F_ISSET(&vip->rep[tcol].e_ch, CH_PASTE); ++tcol)
+                                ;
+                        GET_SPACE_GOTO(sp, bp, blen, tcol - rcol + 1);
+                        for (--rcol, plen = 0; rcol < tcol; ++rcol)
+                                bp[plen++] = vip->rep[rcol].e_c;
+                        tmp = txt_paste(sp, &tp, (CHAR_T *)bp, plen, &flags);
+                        FREE_SPACE(sp, bp, blen);
+                        if (tmp)
+                                goto err;
+                        carat = C_NOTSET;
+                        goto ebuf_chk;
+                }
+        }
+
         /* Wrapmargin check for leading space. */
         if (wm_skip) {
                 wm_skip = 0;
@@ -1974,7 +2041,7 @@ txt_fc(SCR *sp, TEXT *tp, int *redrawp)
         CHAR_T s_ch;
         EXCMD cmd;
         size_t indx, len, nlen, off;
-        int argc, trydir;
+        int argc, istag, trydir;
         char *p, *t;
 
         trydir = 0;
@@ -1999,33 +2066,38 @@ retry:          for (len = 0,
                                 break;
                 }
 
-        /*
-         * Get enough space for a wildcard character.
-         *
-         * XXX
-         * This won't work for "foo\", since the \ will escape the expansion
-         * character.  I'm not sure if that's a bug or not...
-         */
-        off = p - tp->lb;
-        BINC_RET(sp, tp->lb, tp->lb_len, tp->len + 1);
-        p = tp->lb + off;
-
-        s_ch = p[len];
-        p[len] = '*';
-
         /* Build an ex command, and call the ex expansion routines. */
         ex_cinit(&cmd, 0, 0, OOBLNO, OOBLNO, 0, NULL);
         if (argv_init(sp, &cmd))
                 return (1);
-        if (argv_exp2(sp, &cmd, p, len + 1)) {
+
+        /* The argument of a tag command is completed from the tags files. */
+        if ((istag = txt_fc_tag(tp, p)) != 0) {
+                if (ex_tag_complete(sp, &cmd, p, len))
+                        return (1);
+        } else {
+                /*
+                 * Get enough space for a wildcard character.
+                 *
+                 * XXX
+                 * This won't work for "foo\", since the \ will escape the
+                 * expansion character.  I'm not sure if that's a bug or not...
+                 */
+                off = p - tp->lb;
+                BINC_RET(sp, tp->lb, tp->lb_len, tp->len + 1);
+                p = tp->lb + off;
+
+                s_ch = p[len];
+                p[len] = '*';
+                if (argv_exp2(sp, &cmd, p, len + 1)) {
+                        p[len] = s_ch;
+                        return (0);
+                }
                 p[len] = s_ch;
-                return (0);
         }
         argc = cmd.argc;
         argv = cmd.argv;
 
-        p[len] = s_ch;
-
         switch (argc) {
         case 0:                         /* No matches. */
                 if (!trydir)
@@ -2038,7 +2110,7 @@ retry:          for (len = 0,
                         break;
 
                 /* If haven't done a directory test, do it now. */
-                if (!trydir &&
+                if (!trydir && !istag &&
                     !stat(cmd.argv[0]->bp, &sb) && S_ISDIR(sb.st_mode)) {
                         p += len;
                         goto isdir;
@@ -2053,6 +2125,10 @@ retry:          for (len = 0,
                 if (txt_fc_col(sp, argc, argv))
                         return (1);
 
+                /* Substring matches don't share the typed text, keep it. */
+                if (istag && len != 0 && p[0] == '*')
+                        return (0);
+
                 /* Find the length of the shortest match. */
                 for (nlen = cmd.argv[0]->len; --argc > 0;) {
                         if (cmd.argv[argc]->len < nlen)
@@ -2095,7 +2171,8 @@ retry:          for (len = 0,
         }
 
         /* If a single match and it's a directory, retry it. */
-        if (argc == 1 && !stat(cmd.argv[0]->bp, &sb) && S_ISDIR(sb.st_mode)) {
+        if (argc == 1 && !istag &&
+            !stat(cmd.argv[0]->bp, &sb) && S_ISDIR(sb.st_mode)) {
 isdir:          if (tp->owrite == 0) {
                         off = p - tp->lb;
                         BINC_RET(sp, tp->lb, tp->lb_len, tp->len + 1);
@@ -2115,6 +2192,28 @@ isdir:          if (tp->owrite == 0) {
         return (0);
 }
 
+/*
+ * txt_fc_tag --
+ *      Return if the word being completed is the argument of a tag command.
+ */
+static int
+txt_fc_tag(TEXT *tp, char *word)
+{
+        char *p, *t;
+
+        for (p = tp->lb + tp->offset;
+            p < word && (*p == ':' || isblank(*p)); ++p);
+        for (t = p; t < word && isalpha(*t); ++t);
+        if (t == p || !ex_is_tag(p, t - p))
+                return (0);
+        if (t < word && *t == '!')
+                ++t;
+        if (t == word || !isblank(*t))
+                return (0);
+        for (; t < word && isblank(*t); ++t);
+        return (t == word);
+}
+
 /*
  * txt_fc_col --
  *      Display file names for file name completion.
@@ -2498,6 +2597,109 @@ txt_insch(SCR *sp, TEXT *tp, CHAR_T *chp, u_int flags)
         return (0);
 }
 
+/*
+ * txt_paste --
+ *      Insert a paste.
+ *
+ * Pasted text is inserted literally, a line at a time rather than a
+ * character at a time: there's no mapping, no abbreviations, no autoindent
+ * and no wrapmargin.  <carriage-return>, <newline> and <carriage-return>
+ * <newline> pairs break lines, the same way a <carriage-return> from the
+ * user does.
+ */
+static int
+txt_paste(SCR *sp, TEXT **tpp, CHAR_T *p, size_t len, u_int32_t *flagsp)
+{
+        TEXT *ntp, *tp;
+        CHAR_T *ep, *t;
+        size_t insert, n, owrite;
+        u_int32_t flags;
+
+        tp = *tpp;
+        flags = *flagsp;
+        for (ep = p + len;; ++p) {
+                /* Find the end of this line of the paste. */
+                for (t = p; t < ep && *t != '\r' && *t != '\n'; ++t)
+                        ;
+                n = t - p;
+
+                /*
+                 * Replace any overwrite characters a character at a time,
+                 * then insert the rest in one piece.
+                 */
+                for (; n > 0 && tp->owrite != 0; ++p, --n)
+                        if (txt_insch(sp, tp, p, flags))
+                                goto err;
+                if (n > 0) {
+                        BINC_GOTO(sp, tp->lb, tp->lb_len, tp->len + n);
+                        if (tp->insert != 0)
+                                memmove(tp->lb + tp->cno + n,
+                                    tp->lb + tp->cno, tp->insert);
+                        memmove(tp->lb + tp->cno, p, n);
+                        tp->cno += n;
+                        tp->len += n;
+                        p += n;
+                }
+                if (p == ep)
+                        break;
+                if (p[0] == '\r' && p + 1 < ep && p[1] == '\n')
+                        ++p;
+
+                /*
+                 * Break the line.  This is the <carriage-return> code from
+                 * v_txt(), less the autoindent and abbreviation handling.
+                 */
+                if (LF_ISSET(TXT_APPENDEOL) && tp->insert > 0) {
+                        --tp->len;
+                        --tp->insert;
+                }
+                tp->sv_len = tp->len;
+                tp->sv_cno = tp->cno;
+                tp->len = tp->cno;
+                if (vs_change(sp, tp->lno, LINE_RESET))
+                        goto err;
+
+                tp->R_erase = 0;
+                owrite = tp->owrite;
+                insert = tp->insert;
+                if (!LF_ISSET(TXT_REPLACE) || owrite == 0) {
+                        t = tp->lb + tp->cno + owrite;
+                        owrite = 0;
+                } else
+                        t = tp->lb + tp->cno;
+                if ((ntp = text_init(sp, (char *)t,
+                    insert + owrite, insert + owrite + 32)) == NULL)
+                        goto err;
+                TAILQ_INSERT_TAIL(&sp->tiq, ntp, q);
+                ntp->insert = insert;
+                ntp->owrite = owrite;
+                ntp->lno = tp->lno + 1;
+                ntp->cno = ntp->ai;
+
+                /* New lines are TXT_APPENDEOL. */
+                if (ntp->owrite == 0 && ntp->insert == 0) {
+                        BINC_GOTO(sp, ntp->lb, ntp->lb_len, ntp->len + 1);
+                        LF_SET(TXT_APPENDEOL);
+                        ntp->lb[ntp->cno] = CH_CURSOR;
+                        ++ntp->insert;
+                        ++ntp->len;
+                }
+
+                tp = ntp;
+                if (vs_change(sp, tp->lno, LINE_INSERT))
+                        goto err;
+        }
+        *tpp = tp;
+        *flagsp = flags;
+        return (0);
+
+err:
+alloc_err:
+        *tpp = tp;
+        *flagsp = flags;
+        return (1);
+}
+
 /*
  * txt_isrch --
  *      Do an incremental search.
@@ -2625,7 +2827,7 @@ txt_isrch(SCR *sp, VICMD *vp, TEXT *tp, u_int8_t *is_flagsp)
 static int
 txt_resolve(SCR *sp, TEXTH *tiqh, u_int32_t flags)
 {
-        TEXT *tp;
+        TEXT *ntp, *tp;
         recno_t lno;
         int changed;
 
@@ -2646,7 +2848,14 @@ txt_resolve(SCR *sp, TEXTH *tiqh, u_int32_t flags)
             (changed && vs_change(sp, tp->lno, LINE_RESET)))
                 return (1);
 
-        for (lno = tp->lno; (tp = TAILQ_NEXT(tp, q)); ++lno) {
+        /*
+         * Once a line is in the file, it's discarded from the look-aside
+         * buffers.  Otherwise, the search for each line logged as it's
+         * appended starts from the first line, which is quadratic for a
+         * large insert, e.g. a paste.
+         */
+        for (lno = tp->lno; (ntp = TAILQ_NEXT(tp, q)); ++lno) {
+                tp = ntp;
                 if (LF_ISSET(TXT_AUTOINDENT))
                         txt_ai_resolve(sp, tp, &changed);
                 else
@@ -2654,6 +2863,10 @@ txt_resolve(SCR *sp, TEXTH *tiqh, u_int32_t flags)
                 if (db_append(sp, 0, lno, tp->lb, tp->len) ||
                     (changed && vs_change(sp, tp->lno, LINE_RESET)))
                         return (1);
+
+                ntp = TAILQ_FIRST(tiqh);
+                TAILQ_REMOVE(tiqh, ntp, q);
+                text_free(ntp);
         }
 
         /*
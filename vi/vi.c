@@ -407,7 +407,7 @@ intr:                   CLR_INTERRUPT(sp);
 
                 /* Sync recovery if changes were made. */
                 if (F_ISSET(sp->ep, F_RCV_SYNC))
-                        rcv_sync(sp, 0);
+                        rcv_later(sp);
 
                 /* If leaving vi, return to the main editor loop. */
                 if (F_ISSET(gp, G_SRESTART) || F_ISSET(sp, SC_EX)) {
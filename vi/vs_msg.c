@@ -284,10 +284,9 @@ vs_msg(SCR *sp, mtype_t mtype, char *line, size_t len)
 
                 if (mtype == M_ERR)
                         (void)gp->scr_attr(sp, SA_INVERSE, 1);
-                (void)printf("%.*s", (int)len, line);
+                (void)gp->scr_addstr(sp, line, len);
                 if (mtype == M_ERR)
                         (void)gp->scr_attr(sp, SA_INVERSE, 0);
-                (void)fflush(stdout);
 
                 F_CLR(sp, SC_EX_WAIT_NO);
 